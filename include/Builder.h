@@ -3,19 +3,54 @@
 
 #include "State.h"
 #include "ast/Module.h"
+#include "Options.h"
+#include "Stats.h"
+#include "Emitter.h"
 
 #include "llvm/IR/IRBuilder.h"
+#include <unordered_set>
+
+// what the thin lto backend knows of a function without loading the module it is in
+struct FunctionSummary {
+	std::string name;
+	// instructions in its optimized body
+	uint32_t size = 0;
+	// the functions it calls directly that are defined in other modules
+	std::vector<std::string> calls;
+};
 
 class Builder {
 public:
-	void build(Module& module, State& state, const std::string& out_file);
+	Builder(const Options& options, Stats& stats);
+
+	// builds and optimizes the module for the emitter's target & hands it over
+	std::unique_ptr<llvm::Module> build(Module& module, State& state, llvm::LLVMContext& context,
+	                                    const Emitter& target);
+	// optimizes all the modules linked into one as a whole, for lto
+	void optimize_linked(llvm::Module& mass, const Emitter& target);
+
+	// thin lto, which optimizes every module separately with what it calls from the others
+	static std::vector<FunctionSummary> summarize(llvm::Module& llvm_module);
+	// copies the named functions' bodies from another module, only for inlining
+	void import_functions(llvm::Module& llvm_module, std::unique_ptr<llvm::Module> from,
+	                      const std::unordered_set<std::string>& names);
+	void optimize_imported(llvm::Module& llvm_module, const Emitter& target);
 
 private:
+	void optimize(llvm::Module& llvm_module, int opt_level);
 	void do_module(Module& module, llvm::Module& llvm_module, State& state);
+	void declare(Module& module, llvm::Module& llvm_module, bool define_globals);
+	void do_function(Function& func, State& state);
+	void add_attributes(llvm::Constant* llvm_func, const Function& func);
+	void build_shards(Module& module, llvm::Module& llvm_module, unsigned num_threads);
 	bool do_block(llvm::IRBuilder<>& builder, Block& block, State& state);
 	llvm::Value* do_statement(llvm::IRBuilder<>& builder, Statement& statement, State& state);
 	llvm::Value* do_expr(llvm::IRBuilder<>& builder, Expr& expr, State& state);
+	void merge(llvm::IRBuilder<>& builder, const std::vector<Edge>& edges);
+	void find_assigned(const Block& block, std::vector<bool>& assigned);
 	llvm::Value* do_op(llvm::IRBuilder<>& builder, Function& op, std::vector<llvm::Value*>& args);
+	llvm::Value* do_int_op(llvm::IRBuilder<>& builder, char op, bool is_signed,
+	                       llvm::Value* a, llvm::Value* b);
 	llvm::Value* do_cast(llvm::IRBuilder<>& builder, Function& cast, llvm::Value* arg);
 	llvm::Value* do_constructor(llvm::IRBuilder<>& builder, Struct& strukt,
 	                            std::vector<llvm::Value*>& args);
@@ -24,11 +59,26 @@ private:
 	llvm::Type* type_to_llvm(Type& type);
 	llvm::Constant* value_to_llvm(Value& value);
 	llvm::Constant* default_value(Type& type, llvm::Type* llvm_type);
+	llvm::Value* get_llvm(Variable& var);
+
+	const Options& options;
+	Stats& stats;
 
 	llvm::LLVMContext* c;
+	const Emitter* target = nullptr;
 	llvm::Function* llvm_func;
+	// the current value of each of the function's locals by slot, nullptr when out of scope
+	std::vector<llvm::Value*> values;
+	// the stack slot of each struct local instead, which values has no entry for
+	std::vector<llvm::AllocaInst*> homes;
+	// where overflowing arithmetic jumps to with --overflow trap, made once a function needs it
+	llvm::BasicBlock* trap_block = nullptr;
 	std::unordered_map<const Function*, llvm::Constant*> llvm_functions;
 	std::unordered_map<const Struct*, llvm::StructType*> llvm_structs;
+
+	// globals may belong to a module being built on another thread,
+	// so their llvm values are kept here instead of in their Variable
+	std::unordered_map<const Variable*, llvm::Value*> llvm_globals;
 };
 
 
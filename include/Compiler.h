@@ -6,46 +6,105 @@
 #include "Builder.h"
 #include "Tree.h"
 #include "Std.h"
+#include "Options.h"
 #include <fstream>
 #include <atomic>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
 
-namespace llvm { class Module; }
+namespace llvm {
+	class Module;
+	class LLVMContext;
+}
+class ThreadPool;
+class ObjReader;
 
 class Compiler {
 public:
-	Compiler(const std::string& filename, std::string out_build = "", std::string out_exec = "");
-	void initialize(const std::string& filename, bool force_recompile = true);
+	Compiler(const std::string& filename, std::string out_build = "", std::string out_exec = "",
+	         Options options = Options());
+	~Compiler();
+	void initialize(const std::string& filename);
+
+	// jit compiles the linked program and calls its main, returns the exit code
+	int run();
 
 private:
 	struct File {
-		enum State { READY, IN_PROGRESS, FINISHED };
+		enum State { READY, IN_PROGRESS, FINISHED, FAILED };
 		State state = READY;
-		std::ifstream stream;
+		std::thread::id owner;
+		std::string filename;
 		std::unique_ptr<Tokenizer> tokens;
 		Module module;
 		std::string out_filename;
+		// its native object, which executables are linked from
+		std::string native_filename;
 		std::vector<std::string> includes;
+
+		// the include graph, a file is scheduled once all its includes are done
+		std::vector<File*> dependencies;
+		std::vector<File*> dependents;
+		size_t pending = 0;
+
+		// each file is built in its own llvm context, so it is handed to the linker as bitcode
+		std::string bitcode;
+		// its functions' sizes & calls, for thin lto to pick what to import
+		std::vector<FunctionSummary> summary;
+
+		// hash of the source and options, and of the public items once compiled
+		uint64_t cache_key = 0;
+		uint64_t interface_hash = 0;
+		std::vector<File*> imports;
 	};
+	void compile_all();
+	void schedule(ThreadPool& pool, File& file);
 	void compile(File& file);
+	void build(File& file);
+	void await(File& file, const Token* token = nullptr);
 	void resolve(Module& module, State& state);
+	void resolve_items(Module& module, State& state);
+	void resolve(Module& module, Function& func, State& state);
 	void resolve(Module& module, const Block& block, State& state);
 	void resolve(Module& module, Expr* expr,   State& state);
-	void resolve(Module& module, Type& type);
-	std::vector<AccessTok*> resolve(Module& module, State& state, const Token& token,
-	                                Tok* tok = nullptr);
-	Module& import(Module& module, const std::vector<std::string>& name, const Token& token);
+	void resolve(Module& module, Type& type, State& state);
+	// var is set when the name starts with a variable or is a global
+	std::vector<Tok> resolve(Module& module, State& state, const Token& token,
+	                         Tok* tok = nullptr, VarRef* var = nullptr);
+	void declare_param(State& state, const Token& name, Type type);
+	Module& import(Module& module, State& state, const std::vector<std::string>& name,
+	               const Token& token);
 	void create_obj_file(File& file);
-	void load_obj_file(File& file);
+	bool load_obj_file(File& file);
+	Type read_type(ObjReader& in, const std::unordered_map<std::string, Struct*>& structs);
+	Module* find_module(const std::vector<std::string>& name);
+	std::unique_ptr<llvm::Module> parse_bitcode(File& file, llvm::LLVMContext& context);
+	std::unique_ptr<llvm::Module> link_modules(llvm::LLVMContext& context);
+	void link();
+	void link_thin();
+	void link_objects(const std::vector<std::string>& objects);
+	void link_external();
+	// executables are linked from an object per file, other outputs go through bitcode
+	bool needs_native_object() const {
+		return options.emit == Options::EXECUTABLE && !options.external_tools &&
+		       !options.lto && !options.thin_lto;
+	}
 
 	std::vector<std::unique_ptr<File>> files;
 	Tree<File> file_tree;
+	std::unordered_map<std::string, File*> files_by_name;
+	std::unordered_map<const Module*, File*> files_by_module;
+
+	// guards file states, waiting and the dependency counts
+	std::mutex mutex;
+	std::condition_variable file_finished;
+	std::unordered_map<std::thread::id, File*> waiting;
 
 	std::string out_build;
 	std::string out_exec;
-
-	std::vector<Token> extra_tokens;
-	std::vector<std::unique_ptr<Function>> extra_functions;
-	std::vector<std::unique_ptr<Global>> extra_globals;
+	Options options;
+	Stats stats;
 
 	Std std;
 };
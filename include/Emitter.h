@@ -0,0 +1,51 @@
+#ifndef EBC_EMITTER_H
+#define EBC_EMITTER_H
+
+#include "Options.h"
+#include "Stats.h"
+#include <string>
+#include <memory>
+
+namespace llvm {
+	class Module;
+	class TargetMachine;
+	class PassManagerBase;
+	class Type;
+	class LLVMContext;
+}
+
+// generates native code for llvm modules without going through llc,
+// for the target, cpu and features in the options
+class Emitter {
+public:
+	Emitter(const Options& options, Stats& stats);
+	~Emitter();
+
+	// gives the module the target's triple & data layout, best done before optimizing it
+	void prepare(llvm::Module& module) const;
+	// lets the optimizer see the target's costs, so it vectorizes for the right width
+	void add_analysis_passes(llvm::PassManagerBase& pass_manager) const;
+
+	void emit_object(llvm::Module& module, const std::string& filename);
+
+	// the target's native integer width, which Int, IPtr & UPtr take
+	unsigned pointer_bits() const { return ptr_bits; }
+	// the target's c long double, which Float takes
+	llvm::Type* long_double_type(llvm::LLVMContext& context) const;
+
+	// compiles the module in memory and calls eb$main, returning what it returns
+	int run(std::unique_ptr<llvm::Module> module);
+
+private:
+	Stats& stats;
+	int opt_level;
+	std::string triple;
+	std::string cpu;
+	std::string features;
+	unsigned ptr_bits;
+	enum LongDouble { DOUBLE, X86_FP80, FP128, PPC_FP128 };
+	LongDouble long_double = DOUBLE;
+	std::unique_ptr<llvm::TargetMachine> machine;
+};
+
+#endif //EBC_EMITTER_H
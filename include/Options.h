@@ -0,0 +1,76 @@
+#ifndef EBC_OPTIONS_H
+#define EBC_OPTIONS_H
+
+#include "Util.h"
+#include <string>
+#include <thread>
+
+struct Options {
+	// RUN skips writing anything and leaves the program to Compiler::run
+	enum Emit { EXECUTABLE, OBJECT, RUN };
+	Emit emit = EXECUTABLE;
+
+	// shell out to llvm-link, llc and clang instead of linking and generating code in process
+	bool external_tools = false;
+
+	// 0 to 3, picks the pass pipeline run over each module before it is written
+	int opt_level = 0;
+
+	// what integer + - * do when the result doesn't fit: UNDEFINED lets llvm assume it never
+	// happens, WRAP wraps around in two's complement & TRAP stops the program on the spot
+	enum Overflow : uint8_t { UNDEFINED, WRAP, TRAP };
+	Overflow overflow = UNDEFINED;
+
+	// link every file's bitcode together and optimize it as one program before generating code,
+	// so calls between files can be inlined & everything but main internalized
+	bool lto = false;
+	// the same, but each file is optimized & generated on its own with copies of the small
+	// functions it calls from other files, so it scales to every core
+	bool thin_lto = false;
+	// the most instructions a function can have to be imported into other files by thin lto
+	unsigned import_limit = 100;
+
+	// number of files compiled at once, 0 for one per core
+	unsigned jobs = 0;
+
+	// ignore the build cache and rebuild every file
+	bool force_recompile = false;
+
+	// threads type checking & building the functions of one module at once,
+	// 1 keeps them on the file's own thread and 0 is one per core
+	unsigned function_jobs = 1;
+
+	// print timings and counters once done
+	bool stats = false;
+
+	// run the semantic passes together one function at a time, off to debug them one by one
+	bool fuse_passes = true;
+
+	// archive containing the c entry point, linked into executables
+	std::string runtime = "shim.a";
+
+	// the triple to generate code for, the host's when empty
+	std::string target;
+	// cpu to tune and pick instructions for, "native" for the host's own
+	std::string cpu;
+	// comma separated subtarget features on top of the cpu's, like "+avx2,-fma"
+	std::string features;
+
+	unsigned function_threads() const {
+		if (function_jobs != 0) return function_jobs;
+		unsigned cores = std::thread::hardware_concurrency();
+		return cores == 0 ? 1 : cores;
+	}
+
+	// hash of every option that changes the code generated for a module,
+	// cached builds are only reused with the same key
+	uint64_t cache_key() const {
+		uint64_t hash = hash_value(opt_level, hash_value(overflow));
+		for (const std::string* str : { &target, &cpu, &features }) {
+			hash = hash_bytes(str->data(), str->size(), hash_value(str->size(), hash));
+		}
+		return hash;
+	}
+};
+
+#endif //EBC_OPTIONS_H
@@ -11,21 +11,21 @@ public:
 
 private:
 	void                         do_module(Module& module, bool submodule = false);
-	std::unique_ptr<Item>        do_item(Module& module);
-	std::unique_ptr<Function>    do_function();
-	std::unique_ptr<Global>      do_global(bool conzt);
-	std::unique_ptr<Import>      do_import(const Token& kw);
-	std::unique_ptr<Struct>      do_struct(bool pub, Module& module);
-	std::unique_ptr<SubModule>   do_submodule(Module& module, bool extend);
+	Item*        do_item(Module& module);
+	Function*    do_function();
+	Global*      do_global(bool conzt);
+	Import*      do_import(const Token& kw);
+	Struct*      do_struct(bool pub, Module& module);
+	SubModule*   do_submodule(Module& module, bool extend);
 	Block                        do_block();
-	std::unique_ptr<Statement>   do_statement();
-	std::unique_ptr<Declaration> do_declare(const Token& ident);
-	std::unique_ptr<Assignment>  do_assign( const Token& ident, const Token* op_token);
-	std::unique_ptr<Statement>   do_expr(   const Token& first);
-	std::unique_ptr<Statement>   do_return( const Token& kw);
-	std::unique_ptr<If>          do_if(     const Token& kw);
-	std::unique_ptr<While>       do_while(  const Token& kw);
-	std::unique_ptr<Break>       do_break(  const Token& kw);
+	Statement*   do_statement();
+	Declaration* do_declare(const Token& ident);
+	Assignment*  do_assign( const Token& ident, const Token* op_token);
+	Statement*   do_expr(   const Token& first);
+	Statement*   do_return( const Token& kw);
+	If*          do_if(     const Token& kw);
+	While*       do_while(  const Token& kw);
+	Break*       do_break(  const Token& kw);
 	Expr                         do_expr(const std::string& term, bool term_on_end);
 	void                         do_expr(Expr& expr, const std::string& term, bool term_on_end);
 
@@ -38,6 +38,7 @@ private:
 
 	StaticEval eval;
 	const std::vector<Token>* tokens;
+	Arena* arena;
 	size_t index = 0;
 };
 
@@ -3,61 +3,76 @@
 
 #include "ast/Module.h"
 #include "Variable.h"
-#include <unordered_map>
-#include <map>
+#include "SymbolMap.h"
+#include <cassert>
 
 namespace llvm {
 	class BasicBlock;
+	class Value;
 }
 
+// a jump to a block where control flow meets, along with every local's value when it was taken
+struct Edge {
+	llvm::BasicBlock* from;
+	std::vector<llvm::Value*> values;
+};
+
 struct Loop {
 	llvm::BasicBlock* start = nullptr;
 	llvm::BasicBlock* end   = nullptr;
+	// the continues and breaks jumping to it, for its phis
+	std::vector<Edge> continues;
+	std::vector<Edge> breaks;
 };
 
-class Scope {
-public:
-	Scope& to_subscope(Block& block);
-	Scope* get_parent();
-
-	Variable* declare(std::string name, Type type);
-	Variable* get(const std::string& name);
-
-	Loop* get_loop(int amount);
-	void create_loop();
-
-private:
-	Scope* parent = nullptr;
-	std::vector<std::unique_ptr<Scope>> children;
-	std::unordered_map<Block*, Scope*> children_map;
-
-	std::unordered_map<std::string, Variable> variables;
-	std::unique_ptr<Loop> loop;
-};
-
+// scopes only exist while resolving, as one flat stack of names bound to slots
+// in the function's locals, after which every pass finds variables by slot
 class State {
 public:
 	State(Module& module);
 
 	Module& get_module();
 
-	void descend(Block& block);
+	void descend();
 	void ascend();
 
-	Variable* declare(std::string name, Type type);
-	Variable* get_var(const std::string& name) const;
+	// returns the variable's slot, or -1 if the name is already declared in this scope
+	int declare(uint32_t name, Type type);
+	// the innermost variable with this name, falling back to the module's globals
+	VarRef lookup(uint32_t name) const;
+	inline Variable& get_var(const VarRef& ref) const {
+		assert(ref.resolved());
+		return ref.global != nullptr ? *ref.global : current_func->locals[ref.slot];
+	}
 
 	void set_func(Function& func);
 	Function& get_func() const;
 
-	Loop* get_loop(int amount) const;
-	void create_loop();
+	// the loop amount levels out from the innermost one
+	Loop* get_loop(int amount);
+	Loop& push_loop();
+	void pop_loop();
 
 private:
+	struct Binding {
+		int slot = -1;
+		size_t depth = 0;
+	};
+	struct Shadowed {
+		uint32_t name;
+		Binding binding;
+	};
+
 	Module* module;
 	Function* current_func = nullptr;
-	Scope root_scope;
-	Scope* current_scope;
+
+	// keyed by interned name, only ever the innermost binding
+	SymbolMap<Binding> bindings;
+	// the bindings declarations replaced, restored when their scope is left
+	std::vector<Shadowed> shadowed;
+	std::vector<size_t> scope_starts;
+
+	std::vector<Loop> loops;
 };
 
 
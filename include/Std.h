@@ -5,9 +5,17 @@
 
 class Std {
 public:
-	Std();
-	void add_operators(Module& module);
-	Function* get_cast(Type from, Type to);
+	// pointer_size is the target's, in bytes, which Int, IPtr & UPtr take
+	explicit Std(int pointer_size = sizeof(intptr_t));
+	// the builtin overloads of an operator, read without locking since they never change
+	const std::vector<Function*>& get_operators(int num_params, uint32_t name) const;
+	// the implicit cast between two primitive types, or nullptr if there is none
+	// one lookup in a table built by the constructor, so also read without locking
+	inline Function* get_cast(Type from, Type to) const {
+		return casts[from.form][to.form];
+	}
+	// the width of a primitive type in bytes on the target
+	int size(Type type) const;
 
 private:
 	void add_signed(Type type);
@@ -19,11 +27,18 @@ private:
 	void add_comp(Type type);
 	void add_eq(Type type);
 	void add_func(std::string name, std::vector<Type> params, Type ret);
+	void add_casts();
 
-	std::vector<std::unique_ptr<Token>> tokens;
-	std::vector<std::unique_ptr<Function>> operators;
+	int pointer_size;
 
-	std::unordered_map<std::pair<Type, Type>, std::unique_ptr<Function>, pairhash> casts;
+	// owns the operators and casts, all made by the constructor
+	Arena arena;
+	// map of (interned name, num parameters) to the overloads, only filled by the constructor
+	std::unordered_map<uint64_t, std::vector<Function*>> operators;
+
+	// indexed by the forms cast from & to, Float being the last form
+	static const size_t NUM_FORMS = (size_t)Type::Float + 1;
+	Function* casts[NUM_FORMS][NUM_FORMS] = {};
 };
 
 #endif //EBC_ARITH_H
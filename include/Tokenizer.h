@@ -3,9 +3,9 @@
 
 #include "ast/Token.h"
 #include "Except.h"
+#include "Filesystem.h"
 #include <vector>
 #include <stdexcept>
-#include <fstream>
 #include <unordered_map>
 
 enum class Trait { INCLUDE, OUT_BUILD, OUT_EXEC };
@@ -13,22 +13,28 @@ enum class Trait { INCLUDE, OUT_BUILD, OUT_EXEC };
 class Tokenizer {
 public:
 	Tokenizer(const std::string& str);
-	Tokenizer(std::ifstream& file);
+	Tokenizer(const char* data, size_t size);
+	// lexes straight from the mapping, the file only has to outlive the constructor
+	Tokenizer(const MappedFile& file);
 	const std::vector<Token>& get_tokens() const;
 	const std::vector<std::pair<Trait, std::string>>& get_traits() const;
 
 private:
-	void do_whitespace();
+	void tokenize();
 	void do_word();
 	void do_number();
-	void do_symbol();
-	void add_symbol(std::string s);
+	void do_trait();
+	void add_symbol(const char* data, size_t len);
 	void parse_num(  Token& token);
 	void parse_float(Token& token, const std::string&);
 	void parse_int(  Token& token, const std::string&);
 
-	std::string str;
+	// the source being lexed, only valid during the constructor
+	const char* src = nullptr;
+	size_t length = 0;
 	size_t index = 0;
+	// reads as 0 past the end, like a terminated string
+	inline char at(size_t i) const { return i < length ? src[i] : '\0'; }
 
 	std::vector<Token> tokens;
 	std::vector<std::pair<Trait, std::string>> traits;
@@ -36,12 +42,6 @@ private:
 	int line = 1;
 	int column = 1;
 
-	const std::unordered_map<std::string, Token::Form> KEYWORDS = {
-			{"true", Token::KW_TRUE}, {"false", Token::KW_FALSE},
-			{"pub", Token::KW_PUB}, {"fn", Token::KW_FN},
-			{"return", Token::KW_RETURN}, {"if", Token::KW_IF}, {"else", Token::KW_ELSE},
-			{"while", Token::KW_WHILE}, {"continue", Token::KW_CONTINUE}, {"break", Token::KW_BREAK}
-	};
 	const std::unordered_map<std::string, Trait> TRAITS = {
 			{"include", Trait::INCLUDE},
 			{"out_build", Trait::OUT_BUILD}, {"out_exec", Trait::OUT_EXEC}
@@ -3,15 +3,19 @@
 
 #include "ast/Type.h"
 
-namespace llvm { class Value; }
-
 struct Variable {
 	Variable() { }
 	Variable(Type type): type(type) { }
 	Type type = Type::Invalid;
-	llvm::Value* llvm = nullptr;
 	bool is_param = false;
 	bool is_const = false;
 };
 
+// where a resolved name lives, either a slot in its function's locals or a global
+struct VarRef {
+	int slot = -1;
+	Variable* global = nullptr;
+	inline bool resolved() const { return slot != -1 || global != nullptr; }
+};
+
 #endif //EBC_VARIABLE_H
@@ -4,21 +4,8 @@
 #include "Token.h"
 #include "Variable.h"
 #include <vector>
-#include <memory>
-#include <map>
-
-struct Tok {
-	enum Form { VALUE, VAR, FUNC, IF, ACCESS };
-
-	Tok(const Token& token, Form form) :
-			token(&token), form(form) { }
-
-	virtual void _() const { }
-
-	const Token* token;
-	Form form;
-};
-
+#include <string>
+#include <cstdint>
 
 struct Value {
 	Value() { }
@@ -40,30 +27,78 @@ struct Value {
 		double flt;
 	};
 };
-struct ValueTok: public Tok {
-	ValueTok(const Token& token, Value value): Tok(token, VALUE), value(value) {
-		if (value.type == Type::Invalid) this->value.type = Type(token.suffix);
-	}
-	Value value;
+struct Function;
+struct If;
+
+// overload data for a call, kept out of line so every Tok stays the same size
+struct Call {
+	std::vector<std::string> named_args;
+	std::vector<Function*> possible_funcs;
+	// the overload chosen by the type checker
+	Function* func = nullptr;
 };
 
+// one node of a postfix expression, plain data stored inline in the expression
+struct Tok {
+	enum Form : uint8_t { VALUE, VAR, FUNC, IF, ACCESS };
+
+	static Tok make_value(const Token& token, Value value);
+	static Tok make_var(const Token& token);
+	static Tok make_func(const Token& token, int num_args, Call* call = nullptr);
+	static Tok make_if(const Token& token, If* if_statement);
+	static Tok make_access(const Token& token, uint32_t name);
 
-struct VarTok: public Tok {
-	VarTok(const Token& token): Tok(token, VAR) { }
-	Variable* var = nullptr;
-	bool external = false;
-};
+	struct Member {
+		uint32_t name;
+		int idx;
+	};
 
-struct AccessTok: public Tok {
-	AccessTok(const Token& token, std::string name): Tok(token, ACCESS), name(name) { }
-	int idx;
-	std::string name;
-};
+	const Token* token;
+	Form form;
+	bool external = false;         // FUNC, resolved to another module
+	uint16_t num_args = 0;         // FUNC
+	uint16_t num_unnamed_args = 0; // FUNC
+	union {
+		Value value;       // VALUE
+		VarRef var;        // VAR, set on resolve
+		Call* call;        // FUNC, set on resolve unless the parser needed it for named args
+		If* if_statement;  // IF
+		Member member;     // ACCESS, the interned name and the index set by the type checker
+	};
 
+private:
+	Tok(const Token& token, Form form): token(&token), form(form), var() { }
+};
 
-typedef std::vector<std::unique_ptr<Tok>> Expr;
 
-void insert(Expr* expr, std::vector<std::pair<Tok*, Tok*>>& insertions);
-void insert(Expr* expr, std::map<Tok*, Tok*>& insertions);
+// a postfix expression, all of its nodes in one contiguous array
+class Expr {
+public:
+	typedef std::vector<Tok>::iterator iterator;
+	typedef std::vector<Tok>::const_iterator const_iterator;
+
+	inline size_t size() const { return toks.size(); }
+	inline bool empty() const { return toks.empty(); }
+	inline Tok& operator[](size_t i) { return toks[i]; }
+	inline const Tok& operator[](size_t i) const { return toks[i]; }
+	inline Tok& back() { return toks.back(); }
+	inline iterator begin() { return toks.begin(); }
+	inline iterator end() { return toks.end(); }
+	inline const_iterator begin() const { return toks.begin(); }
+	inline const_iterator end() const { return toks.end(); }
+
+	inline void push_back(const Tok& tok) { toks.push_back(tok); }
+	inline void clear() { toks.clear(); }
+	inline void swap(Expr& other) { toks.swap(other.toks); }
+
+	// replaces count nodes from pos with num new ones, only the nodes after them are moved
+	void splice(size_t pos, size_t count, const Tok* new_toks, size_t num);
+	// puts each node right after the one at its index, in place and in one pass from the back
+	// nodes for the same index keep their order
+	void patch(std::vector<std::pair<size_t, Tok>>& patches);
+
+private:
+	std::vector<Tok> toks;
+};
 
 #endif //EBC_EXPR_H
@@ -5,6 +5,7 @@
 #include "Variable.h"
 #include "StaticEval.h"
 #include <unordered_map>
+#include <map>
 
 struct Item {
 	enum Form { MODULE, FUNCTION, GLOBAL, IMPORT, STRUCT };
@@ -46,6 +47,9 @@ struct Function: public Item {
 	std::vector<const Token*> named_param_names;
 	std::map<std::string, int> named_param_map;
 
+	// every variable in the function, the parameters first and then each declaration
+	std::vector<Variable> locals;
+
 	inline void add_param(const Token& name, Type type) {
 		param_types.push_back(type);
 		param_names.push_back(&name);
@@ -61,15 +65,11 @@ struct Function: public Item {
 
 	enum Form { USER, OP, CAST, CONSTRUCTOR };
 	Form form = USER;
-};
-struct FuncTok: public Tok {
-	FuncTok(const Token& token, int num_args):
-			Tok(token, FUNC), num_args(num_args), num_unnamed_args(num_args) { }
-	int num_args;
-	int num_unnamed_args;
-	std::vector<std::string> named_args;
-	std::vector<Function*> possible_funcs;
-	bool external = false;
+
+	// what it may do to memory other than its own locals, set by the purity checker
+	// READ_NONE only depends on its arguments, READ_ONLY may also read globals
+	enum Purity : uint8_t { READ_NONE, READ_ONLY, WRITES };
+	Purity purity = WRITES;
 };
 
 struct Struct: public Item {
@@ -79,7 +79,7 @@ struct Struct: public Item {
 	std::vector<const Token*> member_names;
 	std::unordered_map<std::string, int> member_map;
 	std::string unique_name;
-	std::unique_ptr<Function> constructor;
+	Function* constructor = nullptr;
 
 	inline void add_member(const Token& token, Type type) {
 		member_map[token.str()] = member_names.size();
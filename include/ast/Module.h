@@ -3,51 +3,66 @@
 
 #include "Item.h"
 #include "Tree.h"
+#include "Arena.h"
+#include "SymbolMap.h"
 #include <unordered_set>
 
 class Module {
 public:
 	// returns true if function already exists
 	bool declare(Function& func);
-	const std::vector<Function*>& get_functions(int num_parameters, const std::string& name) const;
+	const std::vector<Function*>& get_functions(int num_parameters, uint32_t name) const;
 	const std::vector<Function*>& get_pub_functions() const;
 
 	bool declare(Global& global);
-	Global* get_global(const std::string& name);
+	Global* get_global(uint32_t name);
 	const std::vector<Global*>& get_pub_globals() const;
 
 	bool declare(Struct& strukt);
-	Struct* get_struct(const std::string& name);
+	Struct* get_struct(uint32_t name);
 	const std::vector<Struct*>& get_pub_structs() const;
 
-	void push_back(std::unique_ptr<Item> item);
+	// the item has to be owned by the arena
+	void push_back(Item* item);
 	size_t size() const;
 	Item& operator[](size_t index);
 	const Item& operator[](size_t index) const;
 
 	bool add_import(const std::vector<std::string>& module_name, Module& module);
-	Module* search(const std::vector<std::string>& module_name);
+	Module* search(const std::vector<std::string>& module_name) const;
+	Module* search(const uint32_t* begin, const uint32_t* end) const;
+	// the module named by the first len parts of the identifier, remembered after the first hit
+	// unlike the others this writes to the module, so only the thread building it may use it
+	Module* search(const Ident& ident, size_t len);
 
 	Module* create_submodule(const std::string& name);
 
+	// owns the items and everything in them, shared with the submodules
+	Arena& arena() { return *arena_ptr; }
+
 	std::vector<std::string> name;
 	std::unordered_set<Item*> external_items;
 
 	Struct* self = nullptr;
 
 private:
+	// declared first so that it is freed last
+	std::shared_ptr<Arena> arena_ptr = std::make_shared<Arena>();
+
 	Tree<Module> imports;
+	// keyed by Ident::path
+	SymbolMap<Module*> paths;
 	std::vector<std::unique_ptr<Module>> submodules;
-	std::vector<std::unique_ptr<Item>> items;
+	std::vector<Item*> items;
 
-	// map of (name, num parameters) to a list of functions
-	std::unordered_map<std::pair<std::string, int>, std::vector<Function*>, pairhash> functions;
+	// all keyed by interned names, functions by (name, num parameters)
+	SymbolMap<std::vector<Function*>> functions;
 	std::vector<Function*> pub_functions;
 
-	std::unordered_map<std::string, Global*> globals;
+	SymbolMap<Global*> globals;
 	std::vector<Global*> pub_globals;
 
-	std::unordered_map<std::string, Struct*> structs;
+	SymbolMap<Struct*> structs;
 	std::vector<Struct*> pub_structs;
 };
 
@@ -5,7 +5,8 @@
 #include <memory>
 
 struct Statement;
-typedef std::vector<std::unique_ptr<Statement>> Block;
+// the statements are owned by their module's arena
+typedef std::vector<Statement*> Block;
 
 struct Statement {
 	enum Form { DECLARATION, ASSIGNMENT, EXPR, RETURN, IF, WHILE, CONTINUE, BREAK };
@@ -20,7 +21,9 @@ struct Statement {
 
 struct Assignment: public Statement {
 	Assignment(const Token& token): Statement(token, ASSIGNMENT) { }
-	std::vector<std::unique_ptr<AccessTok>> accesses;
+	// the members assigned to, as ACCESS nodes
+	std::vector<Tok> accesses;
+	VarRef var;
 };
 
 struct Declaration: public Statement {
@@ -29,6 +32,8 @@ struct Declaration: public Statement {
 	Declaration(const Token& token, const Token& type_token):
 			Statement(token, DECLARATION), type_token(&type_token) { }
 	const Token* type_token = nullptr;
+	// index into the function's locals, set on resolve
+	int slot = -1;
 };
 
 struct If: public Statement {
@@ -41,10 +46,6 @@ struct If: public Statement {
 		return { &true_block, &else_block };
 	}
 };
-struct IfTok: public Tok {
-	IfTok(const Token& token): Tok(token, IF) { }
-	std::unique_ptr<If> if_statement;
-};
 
 struct While: public Statement {
 	While(const Token& token): Statement(token, WHILE) { }
@@ -3,34 +3,76 @@
 #include <cstdint>
 #include <cassert>
 #include <vector>
+#include "util/Interner.h"
 
 #ifndef EBC_TOKEN_H
 #define EBC_TOKEN_H
 
+// the parts of a dotted identifier, only valid as long as the token it came from
+class Ident {
+public:
+	Ident(const uint32_t* ids, size_t count, uint32_t range = 0):
+		ids(ids), count(count), range(range) { }
+
+	inline size_t size() const { return count; }
+	inline const std::string& operator[](size_t i) const {
+		assert(i < count);
+		return Interner::get().str(ids[i]);
+	}
+	inline const std::string& back() const { return (*this)[count - 1]; }
+	inline uint32_t id(size_t i) const { return ids[i]; }
+	inline const uint32_t* begin() const { return ids; }
+	inline const uint32_t* end() const { return ids + count; }
+
+	// a non-zero key for the first len parts, the same for every occurrence of the identifier
+	// since equal ranges are interned once
+	inline uint64_t path(size_t len) const {
+		assert(len > 0 && len <= count);
+		return len == 1 ? (uint64_t)ids[0] << 32 : (uint64_t)range << 32 | len;
+	}
+
+	std::vector<std::string> strs() const {
+		std::vector<std::string> res;
+		for (size_t i = 0; i < count; i++) {
+			res.push_back((*this)[i]);
+		}
+		return res;
+	}
+
+private:
+	const uint32_t* ids;
+	size_t count;
+	uint32_t range;
+};
+
+// strings are interned, a token is a few plain fields and copies for free
 class Token {
 public:
-	enum Form {
+	enum Form : uint8_t {
 		NONE, INVALID, END, FLOAT, INT, KW_TRUE, KW_FALSE, IDENT, SYMBOL,
 		KW_PUB, KW_FN, KW_RETURN, KW_IF, KW_ELSE, KW_WHILE, KW_BREAK, KW_CONTINUE,
 	};
-	enum Suffix { N, I, I8, I16, I32, I64, IPtr, U8, U16, U32, U64, UPtr, F32, F64, F };
+	enum Suffix : uint8_t { N, I, I8, I16, I32, I64, IPtr, U8, U16, U32, U64, UPtr, F32, F64, F };
 
 	Token() { }
-	Token(Form form, std::string str, int line = -1, int column = 0):
-		form(form), line(line), column(column) {
-		str_list.push_back(str);
-	}
+	Token(Form form, const std::string& str, int line = -1, int column = 0):
+		Token(form, Interner::get().intern(str), line, column) { }
+	Token(Form form, uint32_t id, int line = -1, int column = 0):
+		line(line), column(column), form(form), id(id) { }
 
-	int line, column;
+	int line = -1, column = 0;
 	Form form = NONE;
 	Suffix suffix = N;
 
+	// the first part of a dotted identifier
 	inline const std::string& str() const {
-		assert(!str_list.empty());
-		return str_list[0];
+		return Interner::get().str(symbol());
+	}
+	inline uint32_t symbol() const {
+		return parts == 1 ? id : Interner::get().range(id)[0];
 	}
-	inline const std::vector<std::string>& ident() const {
-		return str_list;
+	inline Ident ident() const {
+		return parts == 1 ? Ident(&id, 1) : Ident(Interner::get().range(id), parts, id);
 	}
 
 	inline uint64_t i() const {
@@ -50,18 +92,30 @@ public:
 		assert(form == FLOAT);
 		_f = f;
 	}
-	inline void add_str(std::string str) { str_list.push_back(str); }
+	void add_str(uint32_t part) {
+		std::vector<uint32_t> ids;
+		Ident cur = ident();
+		for (size_t i = 0; i < cur.size(); i++) {
+			ids.push_back(cur.id(i));
+		}
+		ids.push_back(part);
+		id = Interner::get().add_range(ids.data(), ids.size());
+		parts++;
+	}
+	inline void add_str(const std::string& str) { add_str(Interner::get().intern(str)); }
 
 private:
-	std::vector<std::string> str_list;
+	uint16_t parts = 1;
+	// a symbol id, or the start of a range of them when there are several parts
+	uint32_t id = 0;
 	union {
-		uint64_t _i;
+		uint64_t _i = 0;
 		double _f;
 	};
 };
 
 inline bool operator==(const Token& lhs, const Token& rhs) {
-	return lhs.form == rhs.form && lhs.str() == rhs.str();
+	return lhs.form == rhs.form && lhs.symbol() == rhs.symbol();
 }
 inline bool operator!=(const Token& lhs, const Token& rhs) {
 	return !operator==(lhs, rhs);
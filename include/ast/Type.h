@@ -16,12 +16,12 @@ public:
 		Bool,                // either true or false
 		STRUCT, ENUM, TUPLE, // not exist yet
 		IntLit,              // unspecified int literal, can implicitly cast to any numeric type
-		Int,                 // int_fast32_t
+		Int,                 // native width, as wide as the target's pointers
 		U8, U16, U32, U64,   // x-bit unsigned int
 		I8, I16, I32, I64,   // x-bit signed int
 		UPtr, IPtr,          // pointer-sized ints
 		F32, F64,            // x-bit floating point
-		Float                // long double
+		Float                // the target's long double
 	};
 	Type(Form form);
 	Type(Token::Suffix suffix);
@@ -29,6 +29,8 @@ public:
 	Type(Struct& strukt);
 	static Type parse(const Token& token);
 
+	// in bytes, 0 for Int, IPtr & UPtr which depend on the target,
+	// so anything that may see those goes through Std::size instead
 	int size() const;
 	bool is_number() const;
 	bool is_int() const;
@@ -6,14 +6,16 @@
 class Circuiter {
 public:
 	void shorten(Module& module);
+	void shorten(Module& module, Function& func);
 
 private:
 	void shorten(Block& block);
 	void shorten(Expr& expr);
-	void merge(std::vector<int>& side_fx_stack, std::vector<std::vector<std::unique_ptr<Tok>*>>& stack,
+	void merge(std::vector<int>& side_fx_stack, std::vector<std::vector<size_t>>& stack,
 	           std::vector<std::pair<int, int>>& range_stack, int num, bool side_fx, size_t j);
 
-	std::vector<std::unique_ptr<Token>> artificial_nots;
+	// the module being shortened, where the new ifs and tokens go
+	Arena* arena = nullptr;
 };
 
 #endif //EBC_CIRCUITER_H
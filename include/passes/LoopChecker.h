@@ -7,6 +7,7 @@
 class LoopChecker {
 public:
 	void check(Module& module, State& state);
+	void check(Function& func, State& state);
 
 private:
 	void check(Block& block, State& state);
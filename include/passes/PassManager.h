@@ -0,0 +1,52 @@
+#ifndef EBC_PASSMANAGER_H
+#define EBC_PASSMANAGER_H
+
+#include "ast/Module.h"
+#include "Stats.h"
+#include <functional>
+#include <string>
+#include <vector>
+
+// runs the semantic passes over a module's functions
+// fused, each run of function passes is one walk over the functions, every function going
+// through all of them in a row while its blocks are still in cache
+// unfused, every pass walks the whole module on its own, which is easier to debug
+class PassManager {
+public:
+	typedef std::function<void(Module&)> ModulePass;
+	typedef std::function<void(Module&, Function&)> FunctionPass;
+	// also told which of the threads it is on, to use that thread's own state
+	typedef std::function<void(Module&, Function&, unsigned thread)> ParallelPass;
+
+	PassManager(Stats& stats, bool fused = true, unsigned num_threads = 1);
+
+	// runs over the whole module at once, once every pass before it is done
+	void add_module_pass(const std::string& name, ModulePass pass);
+	// runs on one function at a time, fused with the function passes next to it
+	void add_function_pass(const std::string& name, FunctionPass pass);
+	// runs on several functions at once, fused only with the parallel passes next to it
+	void add_parallel_pass(const std::string& name, ParallelPass pass);
+
+	void run(Module& module);
+
+private:
+	struct Pass {
+		std::string name;
+		ModulePass module_pass;
+		FunctionPass function_pass;
+		ParallelPass parallel_pass;
+		Stats::Clock::duration time;
+	};
+
+	// passes [begin, end) are all function passes
+	void run_fused(Module& module, size_t begin, size_t end);
+	// passes [begin, end) are all parallel passes
+	void run_parallel(Module& module, size_t begin, size_t end);
+
+	Stats& stats;
+	bool fused;
+	unsigned num_threads;
+	std::vector<Pass> passes;
+};
+
+#endif //EBC_PASSMANAGER_H
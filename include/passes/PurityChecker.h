@@ -0,0 +1,22 @@
+#ifndef EBC_PURITYCHECKER_H
+#define EBC_PURITYCHECKER_H
+
+#include "ast/Module.h"
+
+// finds which functions never write globals & only call functions that don't either,
+// so the builder can tell llvm it may hoist, merge & drop calls to them
+class PurityChecker {
+public:
+	void check(Module& module);
+
+	size_t pure_functions() const { return num_pure; }
+
+private:
+	Function::Purity check(const Block& block);
+	Function::Purity check(const Expr& expr);
+
+	size_t num_pure = 0;
+};
+
+
+#endif //EBC_PURITYCHECKER_H
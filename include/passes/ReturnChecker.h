@@ -7,6 +7,7 @@
 class ReturnChecker {
 public:
 	void check(Module& module);
+	void check(Module& module, Function& func);
 
 private:
 	bool check(Block& block);
@@ -16,7 +17,8 @@ private:
 	void create_drop(Block& block, const Token& token, Token& tmp);
 
 	int index = 0;
-	std::vector<std::unique_ptr<Token>> phantom_tokens;
+	// the module being checked, where the temporaries go
+	Arena* arena = nullptr;
 };
 
 
@@ -9,16 +9,53 @@
 class TypeChecker {
 public:
 	TypeChecker(Std& std);
+	// for checking functions on several threads, one checker each
+	// what it would add to the module is kept by the checker until merge_into
+	TypeChecker(Std& std, bool detached);
 	void check(Module& module, State& state);
+	void check(Module& module, Function& func, State& state);
+	void merge_into(Module& module);
+
+	// how many calls had their overload chosen, and how many of those were cached
+	size_t overload_lookups() const { return lookups; }
+	size_t overload_hits() const { return hits; }
 
 private:
 	void check(Module& mod, Block& block, State& state);
-	Type check(Module& mod, Expr* expr, State& state, const Token& token, Type res = Type::Invalid);
+	Type check(Expr* expr, State& state, const Token& token, Type res = Type::Invalid);
 
 	Std& std;
+	// the module being checked, where the inserted casts & the items used from other modules go
+	Arena* arena = nullptr;
+	std::unordered_set<Item*>* external_items = nullptr;
+
+	bool detached = false;
+	Arena own_arena;
+	std::unordered_set<Item*> own_external_items;
+
+	// the overload chosen among a set of candidates for some argument types, along with the cast
+	// each argument needs to reach its parameter, or nullptr where it needs none
+	struct Overload {
+		std::vector<Function*> candidates;
+		std::vector<Type> args;
+		Function* func;
+		std::vector<Function*> casts;
+	};
+	// only valid until the next call
+	Overload& choose_overload(const Call& call, const Type* args, size_t num_args,
+	                          const Token& token);
+	static inline uint64_t mix(uint64_t hash, uint64_t word) {
+		hash = (hash ^ word) * 0x9e3779b97f4a7c15ull;
+		return hash ^ (hash >> 32);
+	}
+	// keyed by a hash of the candidates & argument types, the whole key is compared on a hit
+	// each checker has its own, so threads checking at once never share one
+	std::unordered_map<uint64_t, std::vector<Overload>> overloads;
+	size_t lookups = 0;
+	size_t hits = 0;
 
-	void insert_cast(const Token& token, std::map<Tok*, Tok*>& insertions, Tok* tok, Type arg,
-	                 Type param);
+	void insert_cast(const Token& token, std::vector<std::pair<size_t, Tok>>& insertions,
+	                 size_t tok, Type arg, Type param);
 };
 
 
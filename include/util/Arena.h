@@ -0,0 +1,54 @@
+#ifndef EBC_ARENA_H
+#define EBC_ARENA_H
+
+#include <vector>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+#include <new>
+
+// bump allocator that owns everything made in it, all of which is freed together with it
+// only objects that need it get their destructor run, and never recursively
+// not thread safe, each module is only ever added to by one thread at a time
+class Arena {
+public:
+	Arena() { }
+	Arena(const Arena&) = delete;
+	Arena& operator=(const Arena&) = delete;
+	~Arena();
+
+	template<class T, class... Args> T* make(Args&&... args) {
+		T* obj = new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+		if (!std::is_trivially_destructible<T>::value) {
+			destructors.push_back({ [](void* ptr) { ((T*)ptr)->~T(); }, obj });
+		}
+		num_objects++;
+		return obj;
+	}
+	void* allocate(size_t size, size_t align);
+	// takes over everything made in other, leaving it empty
+	void absorb(Arena& other);
+
+	size_t bytes_used() const { return num_bytes; }
+	size_t objects() const { return num_objects; }
+	size_t blocks() const { return owned.size(); }
+
+private:
+	static const size_t BLOCK_SIZE = 64 * 1024;
+
+	struct Destructor {
+		void (*destroy)(void*);
+		void* obj;
+	};
+
+	std::vector<std::unique_ptr<char[]>> owned;
+	char* cur = nullptr;
+	char* end = nullptr;
+	std::vector<Destructor> destructors;
+	size_t num_bytes = 0;
+	size_t num_objects = 0;
+};
+
+#endif //EBC_ARENA_H
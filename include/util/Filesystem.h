@@ -18,4 +18,24 @@ std::vector<std::string> glob(const std::string& filename);
 void create_directory(const std::string& filename);
 bool change_directory(const std::string& directory);
 
+// read only view of a whole file, mapped into memory where the platform allows it
+class MappedFile {
+public:
+	explicit MappedFile(const std::string& filename);
+	~MappedFile();
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	bool is_open() const { return opened; }
+	const char* data() const { return ptr; }
+	size_t size() const { return length; }
+
+private:
+	const char* ptr = "";
+	size_t length = 0;
+	bool opened = false;
+	bool mapped = false;
+	std::string buffer;
+};
+
 #endif //EBC_FILESYSTEM_H
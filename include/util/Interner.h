@@ -0,0 +1,100 @@
+#ifndef EBC_INTERNER_H
+#define EBC_INTERNER_H
+
+#include <string>
+#include <cstdint>
+#include <cstring>
+#include <cassert>
+#include <mutex>
+#include <atomic>
+#include <unordered_map>
+
+// maps every identifier and symbol to a 32 bit id, shared by the whole process
+// strings are stored in fixed chunks that never move, so they can be read without locking
+// dotted identifiers are stored as ranges of consecutive ids, equal ones sharing the same range
+class Interner {
+public:
+	static Interner& get();
+
+	uint32_t intern(const char* data, size_t len);
+	uint32_t intern(const std::string& str) { return intern(str.data(), str.size()); }
+
+	inline const std::string& str(uint32_t id) const {
+		return strings.at(id);
+	}
+
+	// copies the ids into a range unless an equal one exists, returning the index of the first
+	uint32_t add_range(const uint32_t* ids, size_t count);
+	inline const uint32_t* range(uint32_t start) const {
+		return &ranges.at(start);
+	}
+
+	size_t size() const;
+
+private:
+	Interner();
+
+	template<class T, unsigned BITS> class Chunks {
+	public:
+		static const size_t CHUNK = (size_t)1 << BITS;
+		~Chunks() {
+			for (auto& chunk : chunks) delete[] chunk.load();
+		}
+		inline T& at(uint32_t i) const {
+			return chunks[i >> BITS].load(std::memory_order_acquire)[i & (CHUNK - 1)];
+		}
+		// reserves count consecutive slots in one chunk, only called under the interner lock
+		uint32_t reserve(size_t count) {
+			assert(count > 0 && count <= CHUNK);
+			if ((next & (CHUNK - 1)) + count > CHUNK) next = (next | (uint32_t)(CHUNK - 1)) + 1;
+			uint32_t start = next;
+			for (uint32_t i = start >> BITS; i <= (start + count - 1) >> BITS; i++) {
+				if (chunks[i].load(std::memory_order_relaxed) == nullptr) {
+					chunks[i].store(new T[CHUNK](), std::memory_order_release);
+				}
+			}
+			next += (uint32_t)count;
+			return start;
+		}
+		uint32_t next = 0;
+
+	private:
+		// left to the zero initialization of statics, so untouched chunks cost nothing
+		std::atomic<T*> chunks[((size_t)1 << 32) >> BITS];
+	};
+
+	struct Key {
+		const char* data;
+		size_t len;
+	};
+	struct KeyHash {
+		size_t operator()(const Key& key) const;
+	};
+	struct KeyEqual {
+		bool operator()(const Key& lhs, const Key& rhs) const {
+			return lhs.len == rhs.len && memcmp(lhs.data, rhs.data, lhs.len) == 0;
+		}
+	};
+
+	struct RangeKey {
+		const uint32_t* ids;
+		size_t count;
+	};
+	struct RangeKeyHash {
+		size_t operator()(const RangeKey& key) const;
+	};
+	struct RangeKeyEqual {
+		bool operator()(const RangeKey& lhs, const RangeKey& rhs) const {
+			return lhs.count == rhs.count && memcmp(lhs.ids, rhs.ids, lhs.count * 4) == 0;
+		}
+	};
+
+	// keys point into the stored strings and ranges
+	std::unordered_map<Key, uint32_t, KeyHash, KeyEqual> ids;
+	std::unordered_map<RangeKey, uint32_t, RangeKeyHash, RangeKeyEqual> range_ids;
+	Chunks<std::string, 14> strings;
+	Chunks<uint32_t, 16> ranges;
+	mutable std::mutex mutex;
+};
+
+#endif //EBC_INTERNER_H
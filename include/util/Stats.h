@@ -0,0 +1,51 @@
+#ifndef EBC_STATS_H
+#define EBC_STATS_H
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include <ostream>
+#include <cstdint>
+#include <mutex>
+
+// timings and counters collected over a compilation, printed with --stats
+// safe to report to from several threads, times then add up across them
+class Stats {
+public:
+	typedef std::chrono::steady_clock Clock;
+
+	void add_time(const std::string& name, Clock::duration time);
+	void add_count(const std::string& name, uint64_t count);
+	// printed as a percentage of the total, both of which add up over every report
+	void add_ratio(const std::string& name, uint64_t count, uint64_t total);
+	void print(std::ostream& out) const;
+
+private:
+	struct Entry {
+		std::string name;
+		Clock::duration time = Clock::duration::zero();
+		uint64_t count = 0;
+		uint64_t total = 0;
+		bool timed = false;
+		bool ratio = false;
+	};
+	Entry& get(const std::string& name);
+
+	// kept in the order they were first reported
+	std::vector<Entry> entries;
+	mutable std::mutex mutex;
+};
+
+// adds the time between its construction and destruction to the stats
+class Timer {
+public:
+	Timer(Stats& stats, std::string name);
+	~Timer();
+
+private:
+	Stats& stats;
+	std::string name;
+	Stats::Clock::time_point start;
+};
+
+#endif //EBC_STATS_H
@@ -0,0 +1,77 @@
+#ifndef EBC_SYMBOLMAP_H
+#define EBC_SYMBOLMAP_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <cassert>
+#include <utility>
+
+// open addressed map from interned symbol ids to values, with linear probing
+// keys are never 0, since that id is always the empty string, so 0 marks a free slot
+// there is no erase, and values move when it grows so only hold on to them between inserts
+template<class V>
+class SymbolMap {
+public:
+	// for keys made of a symbol and a count, like a function name and its number of parameters
+	static inline uint64_t key(uint32_t symbol, uint32_t count) {
+		return (uint64_t)symbol << 32 | count;
+	}
+
+	inline V* find(uint64_t key) {
+		assert(key != 0);
+		if (slots.empty()) return nullptr;
+		for (size_t i = index(key);; i = (i + 1) & (slots.size() - 1)) {
+			if (slots[i].key == key) return &slots[i].value;
+			if (slots[i].key == 0) return nullptr;
+		}
+	}
+	inline const V* find(uint64_t key) const {
+		return const_cast<SymbolMap*>(this)->find(key);
+	}
+
+	// returns the value for the key, default constructing it if it is new
+	V& operator[](uint64_t key) {
+		assert(key != 0);
+		// kept at most half full, so probes stay short
+		if ((num + 1) * 2 > slots.size()) grow();
+		size_t i = index(key);
+		for (; slots[i].key != 0; i = (i + 1) & (slots.size() - 1)) {
+			if (slots[i].key == key) return slots[i].value;
+		}
+		num++;
+		slots[i].key = key;
+		return slots[i].value;
+	}
+
+	inline size_t size() const { return num; }
+
+private:
+	struct Slot {
+		uint64_t key = 0;
+		V value = V();
+	};
+
+	inline size_t index(uint64_t key) const {
+		// fibonacci hashing, the ids are dense so the high bits of the product spread them out
+		return (size_t)((key * 0x9e3779b97f4a7c15ull) >> 32) & (slots.size() - 1);
+	}
+
+	void grow() {
+		std::vector<Slot> old;
+		old.swap(slots);
+		slots.resize(old.empty() ? 16 : old.size() * 2);
+		for (Slot& slot : old) {
+			if (slot.key == 0) continue;
+			size_t i = index(slot.key);
+			while (slots[i].key != 0) i = (i + 1) & (slots.size() - 1);
+			slots[i].key = slot.key;
+			slots[i].value = std::move(slot.value);
+		}
+	}
+
+	std::vector<Slot> slots;
+	size_t num = 0;
+};
+
+#endif //EBC_SYMBOLMAP_H
@@ -0,0 +1,61 @@
+#ifndef EBC_THREADPOOL_H
+#define EBC_THREADPOOL_H
+
+#include <functional>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <atomic>
+
+class ThreadPool {
+public:
+	// 0 threads means one per core
+	ThreadPool(unsigned num_threads = 0);
+	~ThreadPool();
+
+	void submit(std::function<void()> task);
+
+	// blocks until every submitted task has run, then rethrows the first exception one threw
+	void wait();
+
+	size_t size() const;
+
+private:
+	void work();
+
+	std::vector<std::thread> threads;
+	std::deque<std::function<void()>> tasks;
+	std::mutex mutex;
+	std::condition_variable task_ready;
+	std::condition_variable all_done;
+	size_t active = 0;
+	bool stopping = false;
+	std::exception_ptr error;
+};
+
+// runs work on num_threads threads at once, the calling thread being one of them, and returns
+// once they all have, rethrowing an exception if any of them threw one
+// for splitting up a single task, since waiting on the pool from inside one would wait on
+// every other task too
+void run_parallel(unsigned num_threads, const std::function<void(unsigned thread)>& work);
+
+// hands out the indices below count to whichever thread asks next, so that threads given
+// cheap items come back for more instead of idling while another works through a long share
+class WorkQueue {
+public:
+	WorkQueue(size_t count): count(count) { }
+	// returns false once everything has been handed out
+	inline bool next(size_t& index) {
+		index = claimed.fetch_add(1, std::memory_order_relaxed);
+		return index < count;
+	}
+
+private:
+	std::atomic<size_t> claimed{0};
+	size_t count;
+};
+
+#endif //EBC_THREADPOOL_H
@@ -1,56 +1,60 @@
 #ifndef EBC_TREE_H
 #define EBC_TREE_H
 
+#include "SymbolMap.h"
+#include "Interner.h"
 #include <string>
 #include <vector>
 #include <memory>
-#include <unordered_map>
 
+// trie of dotted module names, keyed by interned ids
+// lookups walk a range of ids in place, without copying the path
 template<class T>
 class Tree {
 private:
 	struct Node {
-		std::unordered_map<std::string, std::unique_ptr<Node>> leaves;
+		SymbolMap<std::unique_ptr<Node>> leaves;
 		T* module = nullptr;
 	};
 
-	bool add(Node& node, std::vector<const std::string*> module_name, T& module) {
-		if (module_name.empty()) {
-			if (node.module != nullptr) return false;
-			node.module = &module;
-			return true;
-		}
-		auto iter = node.leaves.find(*module_name[0]);
-		if (iter == node.leaves.end()) {
-			node.leaves[*module_name[0]].reset(new Node());
-			iter = node.leaves.find(*module_name[0]);
+	Node root;
+
+	static std::vector<uint32_t> intern(const std::vector<std::string>& module_name) {
+		std::vector<uint32_t> ids;
+		for (auto& str : module_name) ids.push_back(Interner::get().intern(str));
+		return ids;
+	}
+
+public:
+	// returns true on success
+	template<class Iter> bool add(Iter begin, Iter end, T& module) {
+		Node* node = &root;
+		for (; begin != end; ++begin) {
+			std::unique_ptr<Node>& leaf = node->leaves[*begin];
+			if (leaf == nullptr) leaf.reset(new Node());
+			node = leaf.get();
 		}
-		module_name.erase(module_name.begin());
-		return add(*iter->second, module_name, module);
+		if (node->module != nullptr) return false;
+		node->module = &module;
+		return true;
 	}
-	T* search(Node& node, std::vector<const std::string*> module_name) {
-		if (module_name.empty()) {
-			return node.module;
+	template<class Iter> T* search(Iter begin, Iter end) const {
+		const Node* node = &root;
+		for (; begin != end; ++begin) {
+			const std::unique_ptr<Node>* leaf = node->leaves.find(*begin);
+			if (leaf == nullptr) return nullptr;
+			node = leaf->get();
 		}
-		auto iter = node.leaves.find(*module_name[0]);
-		if (iter == node.leaves.end()) return nullptr;
-		module_name.erase(module_name.begin());
-		return search(*iter->second, module_name);
+		return node->module;
 	}
 
-	Node root;
-
-public:
-	// returns true on success
 	bool add(const std::vector<std::string>& module_name, T& module) {
-		std::vector<const std::string*> vec;
-		for (auto& str : module_name) vec.push_back(&str);
-		return add(root, vec, module);
+		std::vector<uint32_t> ids = intern(module_name);
+		return add(ids.begin(), ids.end(), module);
 	}
-	T* search(const std::vector<std::string>& module_name) {
-		std::vector<const std::string*> vec;
-		for (auto& str : module_name) vec.push_back(&str);
-		return search(root, vec);
+	T* search(const std::vector<std::string>& module_name) const {
+		std::vector<uint32_t> ids = intern(module_name);
+		return search(ids.begin(), ids.end());
 	}
 };
 
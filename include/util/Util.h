@@ -5,6 +5,7 @@
 #include <iostream>
 #include <sstream>
 #include <vector>
+#include <cstdint>
 
 inline int exec(const char* cmd) {
 	FILE* pipe = popen(cmd, "r");
@@ -45,6 +46,19 @@ inline std::string combine(const std::vector<std::string>& strs, std::string del
 	return res;
 }
 
+// 64 bit fnv-1a, stable between runs so it can be stored in build outputs
+inline uint64_t hash_bytes(const char* data, size_t len,
+                           uint64_t hash = 14695981039346656037ULL) {
+	for (size_t i = 0; i < len; i++) {
+		hash ^= (unsigned char)data[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+template<class T> uint64_t hash_value(const T& val, uint64_t hash = 14695981039346656037ULL) {
+	return hash_bytes((const char*)&val, sizeof(T), hash);
+}
+
 struct pairhash {
 	template <typename T, typename U>
 	std::size_t operator()(const std::pair<T, U> &x) const {
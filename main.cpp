@@ -4,8 +4,87 @@
 using namespace std;
 
 int main(int argc, char** argv) {
-	Compiler compiler;
-	if (argc < 2) return 1;
-	compiler.compile(argv[1], "thang");
+	Options options;
+	string filename;
+	string out_exec;
+	int first = 1;
+	if (argc > 1 && string(argv[1]) == "run") {
+		options.emit = Options::RUN;
+		first = 2;
+	}
+	for (int i = first; i < argc; i++) {
+		string arg = argv[i];
+		if (arg == "-c") {
+			options.emit = Options::OBJECT;
+		} else if (arg == "-o" && i + 1 < argc) {
+			out_exec = argv[++i];
+		} else if (arg.size() == 3 && arg.compare(0, 2, "-O") == 0 && isdigit(arg[2])) {
+			options.opt_level = arg[2] - '0';
+			if (options.opt_level > 3) {
+				cerr << "-O takes 0 to 3, not " << options.opt_level << endl;
+				return 1;
+			}
+		} else if (arg == "-j" && i + 1 < argc) {
+			options.jobs = (unsigned)atoi(argv[++i]);
+		} else if (arg == "--force") {
+			options.force_recompile = true;
+		} else if (arg == "--stats") {
+			options.stats = true;
+		} else if (arg == "--function-jobs" && i + 1 < argc) {
+			options.function_jobs = (unsigned)atoi(argv[++i]);
+		} else if (arg == "--overflow" && i + 1 < argc) {
+			string mode = argv[++i];
+			if (mode == "wrap") {
+				options.overflow = Options::WRAP;
+			} else if (mode == "trap") {
+				options.overflow = Options::TRAP;
+			} else if (mode == "undefined") {
+				options.overflow = Options::UNDEFINED;
+			} else {
+				cerr << "--overflow takes wrap, trap or undefined, not '" << mode << "'" << endl;
+				return 1;
+			}
+		} else if (arg == "--lto") {
+			options.lto = true;
+		} else if (arg == "--thin-lto") {
+			options.thin_lto = true;
+		} else if (arg == "--import-limit" && i + 1 < argc) {
+			options.import_limit = (unsigned)atoi(argv[++i]);
+		} else if (arg == "--unfused-passes") {
+			options.fuse_passes = false;
+		} else if (arg == "--external-tools") {
+			options.external_tools = true;
+		} else if (arg == "--runtime" && i + 1 < argc) {
+			options.runtime = argv[++i];
+		} else if (arg == "--target" && i + 1 < argc) {
+			options.target = argv[++i];
+		} else if (arg == "--cpu" && i + 1 < argc) {
+			options.cpu = argv[++i];
+		} else if (arg == "--features" && i + 1 < argc) {
+			options.features = argv[++i];
+		} else {
+			filename = arg;
+		}
+	}
+	if (filename.empty()) {
+		cerr << "usage: ebc [-c] [-o out] [-O0-3] [--lto] [-j jobs] [--function-jobs jobs] "
+		        "[--force] [--stats]\n"
+		        "           [--overflow wrap|trap|undefined] [--thin-lto] "
+		        "[--import-limit instructions]\n"
+		        "           [--unfused-passes] [--external-tools] [--runtime shim.a]\n"
+		        "           [--target triple] [--cpu name|native] [--features +a,-b] file.eb\n"
+		        "       ebc run [-O0-3] [--lto] [-j jobs] [--function-jobs jobs] [--force] "
+		        "[--stats]\n"
+		        "           [--overflow wrap|trap|undefined] [--cpu name|native] "
+		        "[--features +a,-b] file.eb" << endl;
+		return 1;
+	}
+	try {
+		Compiler compiler(filename, "", out_exec, options);
+		if (options.emit == Options::RUN) return compiler.run();
+	} catch (Except& e) {
+		cerr << e.what() << endl;
+		return 1;
+	}
 	return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,37 @@
+#include "Arena.h"
+
+Arena::~Arena() {
+	// newest first, the same order they would have been destroyed in otherwise
+	for (auto iter = destructors.rbegin(); iter != destructors.rend(); ++iter) {
+		iter->destroy(iter->obj);
+	}
+}
+
+void Arena::absorb(Arena& other) {
+	// the current block stays as it is, so allocating carries on where it left off
+	for (auto& block : other.owned) {
+		owned.push_back(std::move(block));
+	}
+	destructors.insert(destructors.end(), other.destructors.begin(), other.destructors.end());
+	num_bytes += other.num_bytes;
+	num_objects += other.num_objects;
+	other.owned.clear();
+	other.destructors.clear();
+	other.cur = other.end = nullptr;
+	other.num_bytes = other.num_objects = 0;
+}
+
+void* Arena::allocate(size_t size, size_t align) {
+	uintptr_t start = ((uintptr_t)cur + align - 1) & ~(uintptr_t)(align - 1);
+	if (cur == nullptr || start + size > (uintptr_t)end) {
+		// oversized requests get a block of their own
+		size_t block_size = size + align > BLOCK_SIZE ? size + align : BLOCK_SIZE;
+		owned.emplace_back(new char[block_size]);
+		cur = owned.back().get();
+		end = cur + block_size;
+		start = ((uintptr_t)cur + align - 1) & ~(uintptr_t)(align - 1);
+	}
+	cur = (char*)(start + size);
+	num_bytes += size;
+	return (void*)start;
+}
@@ -1,67 +1,131 @@
 #include "Builder.h"
-#include "util/Filesystem.h"
+#include "ThreadPool.h"
+#include "Except.h"
 #include "llvm/IR/Module.h"
+#include "llvm/IR/Intrinsics.h"
 #include "llvm/PassManager.h"
-#include "llvm/Assembly/PrintModulePass.h"
 #include "llvm/Support/raw_ostream.h"
-#include "llvm/Support/raw_os_ostream.h"
 #include "llvm/Bitcode/ReaderWriter.h"
-#include <fstream>
+#include "llvm/Linker.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Transforms/IPO.h"
+#include "llvm/Transforms/IPO/PassManagerBuilder.h"
+#include <algorithm>
 
-void Builder::build(Module& module, State& state, const std::string& out_file) {
-	llvm::Module llvm_module("thang_main", llvm::getGlobalContext());
+Builder::Builder(const Options& options, Stats& stats): options(options), stats(stats) { }
+
+std::unique_ptr<llvm::Module> Builder::build(Module& module, State& state,
+                                             llvm::LLVMContext& context,
+                                             const Emitter& target) {
+	std::unique_ptr<llvm::Module> llvm_module_ptr(new llvm::Module("thang_main", context));
+	llvm::Module& llvm_module = *llvm_module_ptr;
 	c = &llvm_module.getContext();
+	this->target = &target;
+	target.prepare(llvm_module);
 
-	// declare external items
-	for (auto item : module.external_items) {
-		switch (item->form) {
-			case Item::IMPORT: break;
-			case Item::FUNCTION: {
-				Function& func = *(Function*)item;
-				llvm::Type* result = type_to_llvm(func.return_type);
-				std::vector<llvm::Type*> args;
-				for (size_t i = 0; i < func.param_names.size(); i++) {
-					args.push_back(type_to_llvm(func.param_types[i]));
-				}
-				for (size_t i = 0; i < func.named_param_types.size(); i++) {
-					args.push_back(type_to_llvm(func.named_param_types[i]));
-				}
-				auto llvm_args = llvm::ArrayRef<llvm::Type*>(args);
-				llvm::FunctionType* llvm_func = llvm::FunctionType::get(result, llvm_args, false);
-				llvm_functions[&func] = llvm_module.getOrInsertFunction(func.unique_name, llvm_func);
-			} break;
-			case Item::GLOBAL: {
-				Global& global = *(Global*)item;
-				llvm::Type* llvm_type = type_to_llvm(global.var.type);
-				global.var.llvm = llvm_module.getOrInsertGlobal(global.unique_name, llvm_type);
-			} break;
-			case Item::STRUCT: {
-				Struct& strukt = *(Struct*)item;
-				std::vector<llvm::Type*> members;
-				for (size_t i = 0; i < strukt.member_types.size(); i++) {
-					members.push_back(type_to_llvm(strukt.member_types[i]));
-				}
-				auto llvm_args = llvm::ArrayRef<llvm::Type*>(members);
-				llvm_structs[&strukt] = llvm::StructType::create(llvm_args, strukt.unique_name);
-			} break;
-		}
+	{
+		Timer timer(stats, "build ir");
+		do_module(module, llvm_module, state);
 	}
+	optimize(llvm_module, options.opt_level);
+	return llvm_module_ptr;
+}
 
-	do_module(module, llvm_module, state);
+// the standard function and module pipelines for the chosen -O level
+void Builder::optimize(llvm::Module& llvm_module, int opt_level) {
+	if (opt_level <= 0) return;
+	std::stringstream name;
+	name << "optimize -O" << opt_level;
+	Timer timer(stats, name.str());
 
-	std::ofstream file;
-	create_directory(out_file);
-	file.open(out_file);
-	llvm::raw_os_ostream stream(file);
+	llvm::PassManagerBuilder pm_builder;
+	pm_builder.OptLevel = (unsigned)opt_level;
+	pm_builder.SizeLevel = 0;
+	pm_builder.Inliner = llvm::createFunctionInliningPass((unsigned)opt_level, 0);
+	pm_builder.LoopVectorize = opt_level > 1;
+	pm_builder.SLPVectorize  = opt_level > 1;
 
-	if (out_file.back() == 'c') {
-		// bitcode?
-		llvm::WriteBitcodeToFile(&llvm_module, stream);
-	} else {
-		llvm::PassManager pass_manager;
-		pass_manager.add(llvm::createPrintModulePass(&stream));
-		pass_manager.run(llvm_module);
+	llvm::FunctionPassManager function_passes(&llvm_module);
+	target->add_analysis_passes(function_passes);
+	pm_builder.populateFunctionPassManager(function_passes);
+	function_passes.doInitialization();
+	for (llvm::Function& func : llvm_module) {
+		function_passes.run(func);
+	}
+	function_passes.doFinalization();
+
+	llvm::PassManager module_passes;
+	target->add_analysis_passes(module_passes);
+	pm_builder.populateModulePassManager(module_passes);
+	module_passes.run(llvm_module);
+}
+
+// only main stays visible, so the rest can be inlined across files, propagated into & dropped
+void Builder::optimize_linked(llvm::Module& mass, const Emitter& target) {
+	Timer timer(stats, "link time optimize");
+	target.prepare(mass);
+	const char* exported[] = { "eb$main" };
+	llvm::PassManager passes;
+	target.add_analysis_passes(passes);
+	passes.add(llvm::createInternalizePass(llvm::ArrayRef<const char*>(exported, 1)));
+	llvm::PassManagerBuilder pm_builder;
+	pm_builder.populateLTOPassManager(passes, false, true);
+	passes.run(mass);
+}
+
+std::vector<FunctionSummary> Builder::summarize(llvm::Module& llvm_module) {
+	std::vector<FunctionSummary> summaries;
+	for (llvm::Function& func : llvm_module) {
+		if (func.isDeclaration()) continue;
+		FunctionSummary summary;
+		summary.name = func.getName().str();
+		for (llvm::BasicBlock& block : func) {
+			summary.size += (uint32_t)block.size();
+			for (llvm::Instruction& inst : block) {
+				llvm::CallInst* call = llvm::dyn_cast<llvm::CallInst>(&inst);
+				llvm::Function* callee = call == nullptr ? nullptr : call->getCalledFunction();
+				if (callee != nullptr && callee->isDeclaration() && !callee->isIntrinsic()) {
+					summary.calls.push_back(callee->getName().str());
+				}
+			}
+		}
+		std::sort(summary.calls.begin(), summary.calls.end());
+		summary.calls.erase(std::unique(summary.calls.begin(), summary.calls.end()),
+		                    summary.calls.end());
+		summaries.push_back(std::move(summary));
 	}
+	return summaries;
+}
+
+// everything else in the other module is left a declaration, and the imported bodies are
+// available_externally, so they're inlined or dropped but never generated a second time
+void Builder::import_functions(llvm::Module& llvm_module, std::unique_ptr<llvm::Module> from,
+                               const std::unordered_set<std::string>& names) {
+	Timer timer(stats, "import functions");
+	for (llvm::Function& func : *from) {
+		if (func.isDeclaration()) continue;
+		if (names.count(func.getName().str()) && !func.hasLocalLinkage()) {
+			func.setLinkage(llvm::GlobalValue::AvailableExternallyLinkage);
+		} else {
+			func.deleteBody();
+		}
+	}
+	for (auto iter = from->global_begin(); iter != from->global_end(); ++iter) {
+		llvm::GlobalVariable& global = *iter;
+		if (global.isDeclaration() || global.hasLocalLinkage()) continue;
+		global.setInitializer(nullptr);
+	}
+	std::string error;
+	llvm::Linker linker(&llvm_module);
+	if (linker.linkInModule(from.get(), llvm::Linker::DestroySource, &error)) {
+		throw Except("Could not import functions: " + error);
+	}
+}
+
+// inlining what was imported takes at least -O2, like lto
+void Builder::optimize_imported(llvm::Module& llvm_module, const Emitter& target) {
+	this->target = &target;
+	optimize(llvm_module, std::max(options.opt_level, 2));
 }
 
 llvm::Type* Builder::type_to_llvm(Type& type) {
@@ -69,18 +133,17 @@ llvm::Type* Builder::type_to_llvm(Type& type) {
 		assert(llvm_structs.count(type.strukt));
 		return llvm_structs[type.strukt];
 	} else if (type == Type::Float) {
-		switch (sizeof(long double)) {
-			case 8:  return llvm::Type::getDoubleTy(*c);
-			case 10: return llvm::Type::getX86_FP80Ty(*c);
-			case 16: return llvm::Type::getFP128Ty(*c);
-			default: assert(false); break;
-		}
+		assert(target != nullptr);
+		return target->long_double_type(*c);
 	}
 	else if (type == Type::F32)  return llvm::Type::getFloatTy(*c);
 	else if (type == Type::F64)  return llvm::Type::getDoubleTy(*c);
 	else if (type == Type::Void) return llvm::Type::getVoidTy(*c);
 	else if (type == Type::Bool) return llvm::Type::getInt1Ty(*c);
-	else {
+	else if (type == Type::Int || type == Type::IPtr || type == Type::UPtr) {
+		assert(target != nullptr);
+		return llvm::IntegerType::get(*c, target->pointer_bits());
+	} else {
 		assert(type.is_int());
 		return llvm::IntegerType::get(*c, (unsigned)8 * type.size());
 	}
@@ -99,6 +162,68 @@ llvm::Constant* Builder::value_to_llvm(Value& value) {
 }
 
 void Builder::do_module(Module& module, llvm::Module& llvm_module, State& state) {
+	declare(module, llvm_module, true);
+
+	// step 3: do function bodies
+	unsigned num_threads = options.function_threads();
+	if (num_threads > 1) {
+		build_shards(module, llvm_module, num_threads);
+		return;
+	}
+	for (size_t i = 0; i < module.size(); i++) {
+		Item& item = module[i];
+		switch (item.form) {
+			case Item::FUNCTION: {
+				Function& func = (Function&)item;
+				if (func.form != Function::USER) continue;
+				do_function(func, state);
+			} break;
+			default: break;
+		}
+	}
+}
+
+// declares everything in the module & everything it uses from others,
+// only the module being built gets the globals' values
+void Builder::declare(Module& module, llvm::Module& llvm_module, bool define_globals) {
+	// declare external items
+	for (auto item : module.external_items) {
+		switch (item->form) {
+			case Item::IMPORT: break;
+			case Item::FUNCTION: {
+				Function& func = *(Function*)item;
+				llvm::Type* result = type_to_llvm(func.return_type);
+				std::vector<llvm::Type*> args;
+				for (size_t i = 0; i < func.param_names.size(); i++) {
+					args.push_back(type_to_llvm(func.param_types[i]));
+				}
+				for (size_t i = 0; i < func.named_param_types.size(); i++) {
+					args.push_back(type_to_llvm(func.named_param_types[i]));
+				}
+				auto llvm_args = llvm::ArrayRef<llvm::Type*>(args);
+				llvm::FunctionType* llvm_func = llvm::FunctionType::get(result, llvm_args, false);
+				llvm_functions[&func] =
+						llvm_module.getOrInsertFunction(func.unique_name, llvm_func);
+				add_attributes(llvm_functions[&func], func);
+			} break;
+			case Item::GLOBAL: {
+				Global& global = *(Global*)item;
+				llvm::Type* llvm_type = type_to_llvm(global.var.type);
+				llvm_globals[&global.var] =
+						llvm_module.getOrInsertGlobal(global.unique_name, llvm_type);
+			} break;
+			case Item::STRUCT: {
+				Struct& strukt = *(Struct*)item;
+				std::vector<llvm::Type*> members;
+				for (size_t i = 0; i < strukt.member_types.size(); i++) {
+					members.push_back(type_to_llvm(strukt.member_types[i]));
+				}
+				auto llvm_args = llvm::ArrayRef<llvm::Type*>(members);
+				llvm_structs[&strukt] = llvm::StructType::create(llvm_args, strukt.unique_name);
+			} break;
+		}
+	}
+
 	// step 1: declare types
 	for (size_t i = 0; i < module.size(); i++) {
 		Item& item = module[i];
@@ -131,6 +256,7 @@ void Builder::do_module(Module& module, llvm::Module& llvm_module, State& state)
 						llvm::FunctionType::get(ret, llvm::ArrayRef<llvm::Type*>(params), false)
 				);
 				llvm_functions[&func] = llvm_func;
+				add_attributes(llvm_func, func);
 			} break;
 			case Item::GLOBAL: {
 				Global& global = (Global&)item;
@@ -138,8 +264,8 @@ void Builder::do_module(Module& module, llvm::Module& llvm_module, State& state)
 				llvm::GlobalVariable* llvm_global = llvm::cast<llvm::GlobalVariable>(
 						llvm_module.getOrInsertGlobal(global.unique_name, type)
 				);
-				llvm_global->setInitializer(value_to_llvm(global.val));
-				global.var.llvm = llvm_global;
+				if (define_globals) llvm_global->setInitializer(value_to_llvm(global.val));
+				llvm_globals[&global.var] = llvm_global;
 			} break;
 			case Item::STRUCT: {
 				Struct& strukt = (Struct&)item;
@@ -154,27 +280,129 @@ void Builder::do_module(Module& module, llvm::Module& llvm_module, State& state)
 		}
 	}
 
-	// step 3: do function body
+}
+
+void Builder::do_function(Function& func, State& state) {
+	llvm_func = llvm::cast<llvm::Function>(llvm_functions[&func]);
+	state.set_func(func);
+	// the parameters take the first slots, in the same order as the arguments
+	size_t num_params = func.param_types.size() + func.named_param_types.size();
+	values.assign(func.locals.size(), nullptr);
+	trap_block = nullptr;
+	auto iter = llvm_func->arg_begin();
+	for (size_t j = 0; j < num_params; j++) {
+		values[j] = &*iter++;
+	}
+	llvm::IRBuilder<> builder(create_basic_block("entry"));
+	// structs live in memory instead, so their members are read and written one at a time
+	homes.assign(func.locals.size(), nullptr);
+	for (size_t slot = 0; slot < func.locals.size(); slot++) {
+		Variable& var = func.locals[slot];
+		if (!var.type.is_struct()) continue;
+		homes[slot] = builder.CreateAlloca(type_to_llvm(var.type));
+		if (slot < num_params) {
+			builder.CreateStore(values[slot], homes[slot]);
+			values[slot] = nullptr;
+		}
+	}
+	do_block(builder, func.block, state);
+}
+
+// eb has no exceptions, so nothing unwinds, and the purity checker found what leaves memory be
+void Builder::add_attributes(llvm::Constant* value, const Function& func) {
+	llvm::Function* llvm_func = llvm::dyn_cast<llvm::Function>(value);
+	if (llvm_func == nullptr) return;
+	llvm_func->setDoesNotThrow();
+	if (func.purity == Function::READ_NONE) {
+		llvm_func->setDoesNotAccessMemory();
+	} else if (func.purity == Function::READ_ONLY) {
+		llvm_func->setOnlyReadsMemory();
+	}
+}
+
+// the value of every local where the edges meet, at the start of the block they jump to
+// the values that differ get a phi, and those out of scope on any of the edges are dropped
+void Builder::merge(llvm::IRBuilder<>& b, const std::vector<Edge>& edges) {
+	assert(!edges.empty());
+	for (size_t slot = 0; slot < values.size(); slot++) {
+		llvm::Value* first = edges[0].values[slot];
+		bool same = true;
+		for (const Edge& edge : edges) {
+			if (edge.values[slot] == nullptr) {
+				first = nullptr;
+				break;
+			}
+			if (edge.values[slot] != first) same = false;
+		}
+		if (first == nullptr || same) {
+			values[slot] = first;
+			continue;
+		}
+		llvm::PHINode* phi = b.CreatePHI(first->getType(), (unsigned)edges.size());
+		for (const Edge& edge : edges) {
+			phi->addIncoming(edge.values[slot], edge.from);
+		}
+		values[slot] = phi;
+	}
+}
+
+// marks the locals assigned anywhere in the block, which a loop around it needs phis for
+void Builder::find_assigned(const Block& block, std::vector<bool>& assigned) {
+	for (Statement* statement : block) {
+		if (statement->form == Statement::ASSIGNMENT) {
+			Assignment& assign = (Assignment&)*statement;
+			if (assign.var.global == nullptr) assigned[assign.var.slot] = true;
+		}
+		for (Block* inner_block : statement->blocks()) {
+			find_assigned(*inner_block, assigned);
+		}
+	}
+}
+
+// a context can only be used by one thread, so every thread builds its share of the bodies
+// into a module of its own context with everything else declared,
+// then the shards are carried over as bitcode and linked into llvm_module
+void Builder::build_shards(Module& module, llvm::Module& llvm_module, unsigned num_threads) {
+	std::vector<Function*> bodies;
 	for (size_t i = 0; i < module.size(); i++) {
 		Item& item = module[i];
-		switch (item.form) {
-			case Item::FUNCTION: {
-				Function& func = (Function&)item;
-				if (func.form != Function::USER) continue;
-				llvm_func = llvm::cast<llvm::Function>(llvm_functions[&func]);
-				state.descend(func.block);
-				auto iter = llvm_func->arg_begin();
-				for (size_t j = 0; j < func.param_types.size(); j++) {
-					state.get_var(func.param_names[j]->str())->llvm = &*iter++;
-				}
-				for (size_t j = 0; j < func.named_param_types.size(); j++) {
-					state.get_var(func.named_param_names[j]->str())->llvm = &*iter++;
-				}
-				llvm::IRBuilder<> builder(create_basic_block("entry"));
-				do_block(builder, func.block, state);
-				state.ascend();
-			} break;
-			default: break;
+		if (item.form == Item::FUNCTION && ((Function&)item).form == Function::USER) {
+			bodies.push_back((Function*)&item);
+		}
+	}
+	if (num_threads > bodies.size()) num_threads = (unsigned)std::max<size_t>(bodies.size(), 1);
+
+	std::vector<std::string> shards(num_threads);
+	WorkQueue queue(bodies.size());
+	run_parallel(num_threads, [&](unsigned thread) {
+		llvm::LLVMContext context;
+		llvm::Module shard("thang_shard", context);
+		shard.setTargetTriple(llvm_module.getTargetTriple());
+		shard.setDataLayout(llvm_module.getDataLayout());
+		Builder builder(options, stats);
+		builder.c = &context;
+		builder.target = target;
+		builder.declare(module, shard, false);
+		State state(module);
+		size_t index;
+		while (queue.next(index)) {
+			builder.do_function(*bodies[index], state);
+		}
+		llvm::raw_string_ostream stream(shards[thread]);
+		llvm::WriteBitcodeToFile(&shard, stream);
+		stream.flush();
+	});
+
+	llvm::Linker linker(&llvm_module);
+	for (std::string& shard : shards) {
+		std::unique_ptr<llvm::MemoryBuffer> buffer(
+				llvm::MemoryBuffer::getMemBuffer(shard, llvm_module.getModuleIdentifier(), false));
+		std::string error;
+		std::unique_ptr<llvm::Module> shard_module(
+				llvm::ParseBitcodeFile(buffer.get(), *c, &error));
+		if (shard_module == nullptr ||
+		    linker.linkInModule(shard_module.get(), llvm::Linker::DestroySource, &error)) {
+			throw Except("Could not link function shards: " + error);
 		}
 	}
 }
@@ -197,37 +425,41 @@ llvm::Value* Builder::do_statement(llvm::IRBuilder<>& b, Statement& statement, S
 	llvm::Value* drop = nullptr;
 	switch (statement.form) {
 		case Statement::DECLARATION: {
+			// locals other than structs are kept in registers, their current values tracked in values
 			Declaration& decl = (Declaration&)statement;
-			Variable& var = *state.get_var(decl.token.str());
-			auto llvm_type = type_to_llvm(var.type);
-			auto llvm_val = b.CreateAlloca(llvm_type, nullptr, decl.token.str());
-			var.llvm = llvm_val;
+			Variable& var = state.get_func().locals[decl.slot];
 			llvm::Value* assigned;
 			if (decl.expr.empty()) {
 				// TODO: require all variables be initialized before used, so no defaults
+				auto llvm_type = type_to_llvm(var.type);
 				assigned = default_value(var.type, llvm_type);
+				if (assigned == nullptr) assigned = llvm::UndefValue::get(llvm_type);
 			} else {
 				assigned = do_expr(b, decl.expr, state);
 			}
-			if (assigned != nullptr) {
-				b.CreateStore(assigned, llvm_val);
+			if (homes[decl.slot] != nullptr) {
+				if (!decl.expr.empty()) b.CreateStore(assigned, homes[decl.slot]);
+				break;
+			}
+			if (llvm::isa<llvm::Instruction>(assigned) && !assigned->hasName()) {
+				assigned->setName(decl.token.str());
 			}
+			values[decl.slot] = assigned;
 		} break;
 		case Statement::ASSIGNMENT: {
 			Assignment& assign = (Assignment&)statement;
 			llvm::Value* assigned = do_expr(b, assign.expr, state);
-			llvm::Value* dest = state.get_var(assign.token.str())->llvm;
-			if (assign.accesses.empty()) {
-				b.CreateStore(assigned, dest);
-			} else {
-				std::vector<unsigned> idxs;
-				for (auto& access : assign.accesses) {
-					idxs.push_back((unsigned)access->idx);
-				}
-				llvm::Value* strukt = b.CreateLoad(dest, assign.token.str());
-				strukt = b.CreateInsertValue(strukt, assigned, llvm::ArrayRef<unsigned>(idxs));
-				b.CreateStore(strukt, dest);
+			llvm::Value* dest = assign.var.global != nullptr ?
+			                    get_llvm(*assign.var.global) : homes[assign.var.slot];
+			if (dest == nullptr) {
+				values[assign.var.slot] = assigned;
+				break;
+			}
+			// only the member itself is stored, not the whole struct around it
+			for (const Tok& access : assign.accesses) {
+				dest = b.CreateStructGEP(dest, (unsigned)access.member.idx);
 			}
+			b.CreateStore(assigned, dest);
 		} break;
 		case Statement::EXPR: {
 			drop = do_expr(b, statement.expr, state);
@@ -238,54 +470,89 @@ llvm::Value* Builder::do_statement(llvm::IRBuilder<>& b, Statement& statement, S
 		} break;
 		case Statement::IF: {
 			If& if_statement = (If&)statement;
-			bool exits = false;
 			llvm::Value* cond = do_expr(b, if_statement.expr, state);
 			llvm::BasicBlock* if_true  = create_basic_block("if");
 			llvm::BasicBlock* if_false = create_basic_block("else");
 			llvm::BasicBlock* end      = create_basic_block("end");
 			b.CreateCondBr(cond, if_true, if_false);
+			// both branches start from the values before the if, and meet at its end
+			std::vector<Edge> edges;
+			std::vector<llvm::Value*> before = values;
 			b.SetInsertPoint(if_true);
-			state.descend(if_statement.true_block);
 			if (!do_block(b, if_statement.true_block, state)) {
+				edges.push_back({ b.GetInsertBlock(), values });
 				b.CreateBr(end);
-				exits = true;
 			}
-			state.ascend();
+			values = std::move(before);
 			b.SetInsertPoint(if_false);
-			state.descend(if_statement.else_block);
 			if (!do_block(b, if_statement.else_block, state)) {
+				edges.push_back({ b.GetInsertBlock(), values });
 				b.CreateBr(end);
-				exits = true;
 			}
-			state.ascend();
-			if (exits) b.SetInsertPoint(end);
-			else end->eraseFromParent();
+			if (!edges.empty()) {
+				b.SetInsertPoint(end);
+				merge(b, edges);
+			} else {
+				end->eraseFromParent();
+			}
 		} break;
 		case Statement::WHILE: {
 			While& while_statement = (While&)statement;
 			llvm::BasicBlock* start   = create_basic_block("start");
 			llvm::BasicBlock* if_true = create_basic_block("loop");
 			llvm::BasicBlock* end     = create_basic_block("end");
+			llvm::BasicBlock* entry   = b.GetInsertBlock();
 			b.CreateBr(start);
 			b.SetInsertPoint(start);
+			// every local the body assigns gets a phi at the start,
+			// its value from before the loop or from the end of the last time around
+			std::vector<bool> assigned(values.size(), false);
+			find_assigned(while_statement.block, assigned);
+			std::vector<llvm::PHINode*> phis(values.size(), nullptr);
+			for (size_t slot = 0; slot < values.size(); slot++) {
+				if (!assigned[slot] || values[slot] == nullptr) continue;
+				phis[slot] = b.CreatePHI(values[slot]->getType(), 2);
+				phis[slot]->addIncoming(values[slot], entry);
+				values[slot] = phis[slot];
+			}
 			llvm::Value* cond = do_expr(b, while_statement.expr, state);
+			// the loop ends either here or on a break
+			std::vector<Edge> breaks(1, Edge{ b.GetInsertBlock(), values });
 			b.CreateCondBr(cond, if_true, end);
 			b.SetInsertPoint(if_true);
-			state.descend(while_statement.block);
-			Loop& loop = *state.get_loop(1);
+			Loop& loop = state.push_loop();
 			loop.start = start;
 			loop.end   = end;
-			do_block(b, while_statement.block, state);
-			state.ascend();
-			b.CreateBr(start);
+			bool exits = do_block(b, while_statement.block, state);
+			// nested loops may have moved it
+			Loop& done = *state.get_loop(1);
+			std::vector<Edge> continues = std::move(done.continues);
+			breaks.insert(breaks.end(), done.breaks.begin(), done.breaks.end());
+			state.pop_loop();
+			if (!exits) {
+				continues.push_back({ b.GetInsertBlock(), values });
+				b.CreateBr(start);
+			}
+			for (size_t slot = 0; slot < values.size(); slot++) {
+				if (phis[slot] == nullptr) continue;
+				for (const Edge& edge : continues) {
+					assert(edge.values[slot] != nullptr);
+					phis[slot]->addIncoming(edge.values[slot], edge.from);
+				}
+			}
 			b.SetInsertPoint(end);
+			merge(b, breaks);
+		} break;
+		case Statement::CONTINUE: {
+			Loop& loop = *state.get_loop(1);
+			loop.continues.push_back({ b.GetInsertBlock(), values });
+			b.CreateBr(loop.start);
 		} break;
-		case Statement::CONTINUE:
-			b.CreateBr(state.get_loop(1)->start);
-			break;
 		case Statement::BREAK: {
 			Break& break_statement = (Break&)statement;
-			b.CreateBr(state.get_loop(break_statement.amount)->end);
+			Loop& loop = *state.get_loop(break_statement.amount);
+			loop.breaks.push_back({ b.GetInsertBlock(), values });
+			b.CreateBr(loop.end);
 		} break;
 	}
 	return drop;
@@ -295,24 +562,37 @@ llvm::Value* Builder::do_expr(llvm::IRBuilder<>& builder, Expr& expr, State& sta
 	std::vector<llvm::Value*> value_stack;
 	std::vector<Type*> type_stack;
 	for (size_t j = 0; j < expr.size(); j++) {
-		Tok& tok = *expr[j];
+		Tok& tok = expr[j];
 		switch (tok.form) {
 			case Tok::VALUE:
-				value_stack.push_back(value_to_llvm(((ValueTok&)tok).value));
-				type_stack.push_back(&((ValueTok&)tok).value.type);
+				value_stack.push_back(value_to_llvm(tok.value));
+				type_stack.push_back(&tok.value.type);
 				break;
 			case Tok::VAR: {
-				Variable& var = *state.get_var(tok.token->str());
-				if (var.is_param) {
-					value_stack.push_back(var.llvm);
-				} else {
-					value_stack.push_back(builder.CreateLoad(var.llvm, tok.token->str().c_str()));
+				Variable& var = state.get_var(tok.var);
+				Type* type = &var.type;
+				llvm::Value* ptr = tok.var.global != nullptr ?
+				                   get_llvm(var) : homes[tok.var.slot];
+				if (ptr == nullptr) {
+					assert(values[tok.var.slot] != nullptr);
+					value_stack.push_back(values[tok.var.slot]);
+					type_stack.push_back(type);
+					break;
+				}
+				// the accesses straight after it are folded into the address,
+				// so only the member they end on is loaded
+				for (; j + 1 < expr.size() && expr[j + 1].form == Tok::ACCESS; j++) {
+					int idx = expr[j + 1].member.idx;
+					ptr = builder.CreateStructGEP(ptr, (unsigned)idx);
+					type = &type->strukt->member_types[idx];
 				}
-				type_stack.push_back(&var.type);
+				value_stack.push_back(builder.CreateLoad(ptr, tok.token->str()));
+				type_stack.push_back(type);
 			} break;
 			case Tok::ACCESS: {
+				// an access on a value that isn't in memory, like a call's result
 				assert(type_stack.back()->is_struct());
-				int idx = ((AccessTok&)tok).idx;
+				int idx = tok.member.idx;
 				auto arr = llvm::ArrayRef<unsigned>((unsigned)idx);
 				auto value = value_stack.back();
 				value_stack.pop_back();
@@ -320,33 +600,34 @@ llvm::Value* Builder::do_expr(llvm::IRBuilder<>& builder, Expr& expr, State& sta
 				type_stack[type_stack.size() - 1] = &type_stack.back()->strukt->member_types[idx];
 			} break;
 			case Tok::FUNC: {
-				FuncTok& ftok = (FuncTok&)tok;
-				assert(ftok.possible_funcs.size() == 1);
-				Function& func = *ftok.possible_funcs[0];
+				assert(tok.call != nullptr && tok.call->func != nullptr);
+				Function& func = *tok.call->func;
+				const std::vector<std::string>& named_args = tok.call->named_args;
 				std::vector<llvm::Value*> args;
 				for (int i = 0; i < func.param_names.size(); i++) {
-					args.push_back(value_stack[value_stack.size() - ftok.num_args + i]);
+					args.push_back(value_stack[value_stack.size() - tok.num_args + i]);
 				}
 				for (size_t i = 0; i < func.named_param_types.size(); i++) {
 					Value& val = func.named_param_vals[i];
 					args.push_back(val.type == Type::Invalid ? nullptr : value_to_llvm(val));
 				}
-				for (size_t i = 0; i < ftok.named_args.size(); i++) {
-					int func_index = func.named_param_map[ftok.named_args[i]];
-					size_t stack_off = value_stack.size() - ftok.num_args + ftok.num_unnamed_args;
+				for (size_t i = 0; i < named_args.size(); i++) {
+					// the checker made sure it exists, and shards share the function
+					int func_index = func.named_param_map.at(named_args[i]);
+					size_t stack_off = value_stack.size() - tok.num_args + tok.num_unnamed_args;
 					args[func.param_names.size() + func_index] = value_stack[stack_off + i];
 				}
-				value_stack.erase(value_stack.end() - ftok.num_args, value_stack.end());
-				type_stack.erase(  type_stack.end() - ftok.num_args,  type_stack.end());
+				value_stack.erase(value_stack.end() - tok.num_args, value_stack.end());
+				type_stack.erase(  type_stack.end() - tok.num_args,  type_stack.end());
 				if (func.form == Function::OP) {
 					value_stack.push_back(do_op(builder, func, args));
 				} else if (func.form == Function::CAST) {
 					value_stack.push_back(do_cast(builder, func, args[0]));
 				} else if (func.form == Function::CONSTRUCTOR) {
-					Struct* strukt = state.get_module().get_struct(func.token.str());
+					Struct* strukt = state.get_module().get_struct(func.token.symbol());
 					value_stack.push_back(do_constructor(builder, *strukt, args));
 				} else {
-					assert(llvm_functions.count(ftok.possible_funcs[0]));
+					assert(llvm_functions.count(&func));
 					value_stack.push_back(builder.CreateCall(
 							llvm_functions[&func],
 							llvm::ArrayRef<llvm::Value*>(args), func.token.str()
@@ -371,6 +652,11 @@ llvm::Constant* Builder::default_value(Type& type, llvm::Type* llvm_type) {
 	}
 }
 
+llvm::Value* Builder::get_llvm(Variable& var) {
+	assert(llvm_globals.count(&var));
+	return llvm_globals[&var];
+}
+
 llvm::Value* Builder::do_op(llvm::IRBuilder<>& builder, Function& op,
                             std::vector<llvm::Value*>& args) {
 	if (args.size() == 2) {
@@ -378,15 +664,12 @@ llvm::Value* Builder::do_op(llvm::IRBuilder<>& builder, Function& op,
 		auto b = args[1];
 		Type type = op.param_types[0];
 		switch (op.token.str()[0]) {
-			case '+': return type.is_float()  ? builder.CreateFAdd(a, b) :
-			                 type.is_signed() ? builder.CreateNSWAdd(a, b) :
-			                                    builder.CreateNUWAdd(a, b);
-			case '-': return type.is_float()  ? builder.CreateFSub(a, b) :
-			                 type.is_signed() ? builder.CreateNSWSub(a, b) :
-			                                    builder.CreateNUWSub(a, b);
-			case '*': return type.is_float()  ? builder.CreateFMul(a, b) :
-			                 type.is_signed() ? builder.CreateNSWMul(a, b) :
-			                                    builder.CreateNUWMul(a, b);
+			case '+': return type.is_float() ? builder.CreateFAdd(a, b) :
+			                                   do_int_op(builder, '+', type.is_signed(), a, b);
+			case '-': return type.is_float() ? builder.CreateFSub(a, b) :
+			                                   do_int_op(builder, '-', type.is_signed(), a, b);
+			case '*': return type.is_float() ? builder.CreateFMul(a, b) :
+			                                   do_int_op(builder, '*', type.is_signed(), a, b);
 			case '/': return type.is_float()  ? builder.CreateFDiv(a, b) :
 			                 type.is_signed() ? builder.CreateSDiv(a, b) :
 			                                    builder.CreateUDiv(a, b);
@@ -425,9 +708,9 @@ llvm::Value* Builder::do_op(llvm::IRBuilder<>& builder, Function& op,
 		Type type = op.param_types[0];
 		switch (op.token.str()[0]) {
 			case '!': return builder.CreateNot(a);
-			case '-': return type.is_float()  ? builder.CreateFNeg(a) :
-			                 type.is_signed() ? builder.CreateNSWNeg(a) :
-		                                        builder.CreateNUWNeg(a);
+			case '-': return type.is_float() ? builder.CreateFNeg(a) :
+			                 do_int_op(builder, '-', type.is_signed(),
+			                           llvm::ConstantInt::get(a->getType(), 0), a);
 			case '/': return type.is_float()  ? builder.CreateFDiv(llvm::ConstantFP::get(a->getType(), 0), a) :
 			                 type.is_signed() ? builder.CreateSDiv(llvm::ConstantInt::get(a->getType(), 0), a) :
 		                                        builder.CreateUDiv(llvm::ConstantInt::get(a->getType(), 0), a);
@@ -436,6 +719,48 @@ llvm::Value* Builder::do_op(llvm::IRBuilder<>& builder, Function& op,
 	}
 }
 
+// + - * on integers, doing what the options say when the result doesn't fit
+llvm::Value* Builder::do_int_op(llvm::IRBuilder<>& builder, char op, bool is_signed,
+                                llvm::Value* a, llvm::Value* b) {
+	switch (options.overflow) {
+		case Options::UNDEFINED:
+			if (op == '+') {
+				return is_signed ? builder.CreateNSWAdd(a, b) : builder.CreateNUWAdd(a, b);
+			} else if (op == '-') {
+				return is_signed ? builder.CreateNSWSub(a, b) : builder.CreateNUWSub(a, b);
+			}
+			return is_signed ? builder.CreateNSWMul(a, b) : builder.CreateNUWMul(a, b);
+		case Options::WRAP:
+			if (op == '+') return builder.CreateAdd(a, b);
+			if (op == '-') return builder.CreateSub(a, b);
+			return builder.CreateMul(a, b);
+		case Options::TRAP: break;
+	}
+	llvm::Intrinsic::ID id =
+			op == '+' ? (is_signed ? llvm::Intrinsic::sadd_with_overflow :
+			                         llvm::Intrinsic::uadd_with_overflow) :
+			op == '-' ? (is_signed ? llvm::Intrinsic::ssub_with_overflow :
+			                         llvm::Intrinsic::usub_with_overflow) :
+			            (is_signed ? llvm::Intrinsic::smul_with_overflow :
+			                         llvm::Intrinsic::umul_with_overflow);
+	llvm::Module* llvm_module = llvm_func->getParent();
+	llvm::Function* with_overflow = llvm::Intrinsic::getDeclaration(
+			llvm_module, id, llvm::ArrayRef<llvm::Type*>(a->getType()));
+	llvm::Value* result = builder.CreateCall2(with_overflow, a, b);
+
+	// every overflow in the function goes to the same trap
+	if (trap_block == nullptr) {
+		trap_block = create_basic_block("overflow");
+		llvm::IRBuilder<> trap(trap_block);
+		trap.CreateCall(llvm::Intrinsic::getDeclaration(llvm_module, llvm::Intrinsic::trap));
+		trap.CreateUnreachable();
+	}
+	llvm::BasicBlock* fits = create_basic_block("fits");
+	builder.CreateCondBr(builder.CreateExtractValue(result, 1), trap_block, fits);
+	builder.SetInsertPoint(fits);
+	return builder.CreateExtractValue(result, 0);
+}
+
 llvm::Value* Builder::do_cast(llvm::IRBuilder<>& builder, Function& cast, llvm::Value* arg) {
 	if (cast.return_type.is_float()) {
 		return builder.CreateSIToFP(arg, type_to_llvm(cast.return_type));
@@ -5,14 +5,18 @@ void Circuiter::shorten(Module& module) {
 		Item& item = module[i];
 		switch (item.form) {
 			case Item::FUNCTION: {
-				Function& func = (Function&)item;
-				shorten(func.block);
+				shorten(module, (Function&)item);
 			} break;
 			default: break;
 		}
 	}
 }
 
+void Circuiter::shorten(Module& module, Function& func) {
+	arena = &module.arena();
+	shorten(func.block);
+}
+
 void Circuiter::shorten(Block& block) {
 	for (size_t i = 0; i < block.size(); i++) {
 		Statement& statement = *block[i];
@@ -22,85 +26,70 @@ void Circuiter::shorten(Block& block) {
 
 void Circuiter::shorten(Expr& expr) {
 	std::vector<int> has_side_fx_stack;
-	std::vector<std::vector<std::unique_ptr<Tok>*>> stack;
+	std::vector<std::vector<size_t>> stack;
 	std::vector<std::pair<int, int>> range_stack;
 	If* new_if = nullptr;
 	const Token* new_if_token = nullptr;
 	for (size_t j = 0; j < expr.size(); j++) {
-		Tok& tok = *expr[j];
+		Tok& tok = expr[j];
 		switch (tok.form) {
 			case Tok::VALUE: case Tok::VAR:
 				has_side_fx_stack.push_back(false);
-				stack.push_back(std::vector<std::unique_ptr<Tok>*>(1, &expr[j]));
+				stack.push_back(std::vector<size_t>(1, j));
 				range_stack.push_back(std::make_pair(j, j + 1));
 				break;
 			case Tok::IF: {
 				has_side_fx_stack.push_back(true);
-				stack.push_back(std::vector<std::unique_ptr<Tok>*>(1, &expr[j]));
+				stack.push_back(std::vector<size_t>(1, j));
 				range_stack.push_back(std::make_pair(j, j + 1));
-				shorten(((IfTok&)tok).if_statement->expr);
+				shorten(tok.if_statement->expr);
 			} break;
 			case Tok::FUNC: {
-				FuncTok& ftok = (FuncTok&)tok;
-				const std::string& name = ftok.token->str();
+				const std::string& name = tok.token->str();
 				if ((name == "&&" || name == "||") && has_side_fx_stack.back()) {
 					// a || b  -->  if  a { true  } else { b }
 					// a && b  -->  if !a { false } else { b }
-					new_if = new If(*tok.token);
-					auto& cond = stack[stack.size() - 2];
-					for (size_t i = 0; i < cond.size(); i++) {
-						new_if->expr.emplace_back();
-						new_if->expr.back().swap(*cond[i]);
+					new_if = arena->make<If>(*tok.token);
+					for (size_t i : stack[stack.size() - 2]) {
+						new_if->expr.push_back(expr[i]);
 					}
-					Token* anot = new Token(Token::SYMBOL, "!", tok.token->line, tok.token->column);
-					artificial_nots.push_back(std::unique_ptr<Token>(anot));
-					if (name == "&&") new_if->expr.emplace_back(new FuncTok(*anot, 1));
-					new_if->true_block.emplace_back(new Statement(*tok.token, Statement::EXPR));
-					ValueTok* vtok = new ValueTok(*tok.token, Value(name == "||"));
-					new_if->true_block[0]->expr.push_back(std::unique_ptr<Tok>(vtok));
-					auto& else_expr = stack[stack.size() - 1];
-					new_if->else_block.emplace_back(new Statement(*tok.token, Statement::EXPR));
-					for (size_t i = 0; i < else_expr.size(); i++) {
-						new_if->else_block[0]->expr.emplace_back();
-						new_if->else_block[0]->expr.back().swap(*else_expr[i]);
+					Token* anot = arena->make<Token>(Token::SYMBOL, "!", tok.token->line,
+					                                 tok.token->column);
+					if (name == "&&") new_if->expr.push_back(Tok::make_func(*anot, 1));
+					new_if->true_block.push_back(
+						arena->make<Statement>(*tok.token, Statement::EXPR));
+					new_if->true_block[0]->expr.push_back(
+						Tok::make_value(*tok.token, Value(name == "||")));
+					new_if->else_block.push_back(
+						arena->make<Statement>(*tok.token, Statement::EXPR));
+					for (size_t i : stack[stack.size() - 1]) {
+						new_if->else_block[0]->expr.push_back(expr[i]);
 					}
 					merge(has_side_fx_stack, stack, range_stack, 2, true, j);
 					new_if_token = tok.token;
 					goto end_loop;
 				}
-				merge(has_side_fx_stack, stack, range_stack, ftok.num_args,
-				      /* hack to test if not operator */ ftok.token->form != Token::SYMBOL, j);
-				stack.back().push_back(&expr[j]);
+				merge(has_side_fx_stack, stack, range_stack, tok.num_args,
+				      /* hack to test if not operator */ tok.token->form != Token::SYMBOL, j);
+				stack.back().push_back(j);
 			} break;
 			default: assert(false);
 		}
 	}
 	end_loop:
 	if (new_if == nullptr) return;
-	Expr copy;
-	copy.resize(expr.size());
-	for (size_t i = 0; i < copy.size(); i++) {
-		copy[i].swap(expr[i]);
-	}
-	expr.clear();
-	for (size_t i = 0; i < copy.size(); i++) {
-		if (i == range_stack.back().first) {
-			IfTok* tok = new IfTok(*new_if_token);
-			tok->if_statement.reset(new_if);
-			expr.emplace_back(std::unique_ptr<IfTok>(tok));
-			i = (size_t)range_stack.back().second - 1;
-		} else {
-			expr.push_back(std::move(copy[i]));
-		}
-	}
+	// the whole subexpression collapses into the one if node
+	Tok if_tok = Tok::make_if(*new_if_token, new_if);
+	auto range = range_stack.back();
+	expr.splice((size_t)range.first, (size_t)(range.second - range.first), &if_tok, 1);
 	shorten(expr);
 }
 
 void Circuiter::merge(std::vector<int>& side_fx_stack,
-                      std::vector<std::vector<std::unique_ptr<Tok>*>>& stack,
+                      std::vector<std::vector<size_t>>& stack,
                       std::vector<std::pair<int, int>>& range_stack, int num, bool side_fx,
                       size_t j) {
-	std::vector<std::unique_ptr<Tok>*> vec;
+	std::vector<size_t> vec;
 	std::pair<int, int> range(j, j + 1);
 	for (int i = num; i >= 1; i--) {
 		auto& to_add = stack[stack.size() - i];
@@ -3,19 +3,181 @@
 #include "passes/Circuiter.h"
 #include "passes/ReturnChecker.h"
 #include "passes/TypeChecker.h"
+#include "passes/PassManager.h"
+#include "passes/PurityChecker.h"
 #include "Filesystem.h"
+#include "Emitter.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/Linker.h"
+#include "llvm/Bitcode/ReaderWriter.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/Threading.h"
+#include "llvm/Support/raw_ostream.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cstring>
 
-Compiler::Compiler(const std::string& filename, std::string out_build, std::string out_exec)
-		: out_build(out_build), out_exec(out_exec) {
+Compiler::Compiler(const std::string& filename, std::string out_build, std::string out_exec,
+                   Options options)
+		: out_build(out_build), out_exec(out_exec), options(options),
+		  // overloads are ranked by width, so the front end needs the target's as well
+		  std((int)Emitter(options, stats).pointer_bits() / 8) {
 	initialize(filename);
+	compile_all();
+	if (options.emit == Options::RUN) return;
 
+	if (options.external_tools) {
+		link_external();
+	} else if (options.emit == Options::OBJECT || options.lto) {
+		link();
+	} else if (options.thin_lto) {
+		link_thin();
+	} else {
+		std::vector<std::string> objects;
+		for (auto& file : files) {
+			objects.push_back(file->native_filename);
+		}
+		link_objects(objects);
+	}
+
+	if (options.stats) stats.print(std::cout);
+}
+
+Compiler::~Compiler() { }
+
+int Compiler::run() {
+	llvm::LLVMContext context;
+	std::unique_ptr<llvm::Module> mass = link_modules(context);
+	Emitter emitter(options, stats);
+	if (options.lto) {
+		Builder builder(options, stats);
+		builder.optimize_linked(*mass, emitter);
+	}
+	int result = emitter.run(std::move(mass));
+	if (options.stats) stats.print(std::cout);
+	return result;
+}
+
+// links the modules in memory and generates a single object file directly,
+// optimizing them as one program first with lto
+void Compiler::link() {
+	llvm::LLVMContext context;
+	std::unique_ptr<llvm::Module> mass = link_modules(context);
+
+	Emitter emitter(options, stats);
+	if (options.lto) {
+		Builder builder(options, stats);
+		builder.optimize_linked(*mass, emitter);
+	}
+	if (options.emit == Options::OBJECT) {
+		emitter.emit_object(*mass, out_exec.empty() ? "out.o" : out_exec);
+		return;
+	}
+	std::string out_o = concat_paths(out_build, "out.o");
+	emitter.emit_object(*mass, out_o);
+	link_objects({ out_o });
+}
+
+// every file is optimized again with bodies of the small functions it calls from other files,
+// picked using the summaries alone, and then generated, each of them on a thread of its own
+void Compiler::link_thin() {
+	struct Definition {
+		File* file;
+		const FunctionSummary* summary;
+	};
+	std::unordered_map<std::string, Definition> index;
 	for (auto& file : files) {
-		compile(*file);
+		for (const FunctionSummary& summary : file->summary) {
+			index[summary.name] = { file.get(), &summary };
+		}
 	}
 
+	std::vector<std::string> objects(files.size());
+	WorkQueue queue(files.size());
+	unsigned num_threads = options.jobs != 0 ? options.jobs : std::thread::hardware_concurrency();
+	num_threads = (unsigned)std::min<size_t>(std::max(num_threads, 1u), files.size());
+	run_parallel(num_threads, [&](unsigned) {
+		size_t i;
+		while (queue.next(i)) {
+			File& file = *files[i];
+			std::unordered_map<File*, std::unordered_set<std::string>> imports;
+			size_t num_imported = 0;
+			for (const FunctionSummary& summary : file.summary) {
+				for (const std::string& call : summary.calls) {
+					auto iter = index.find(call);
+					if (iter == index.end() || iter->second.file == &file) continue;
+					if (iter->second.summary->size > options.import_limit) continue;
+					num_imported += imports[iter->second.file].insert(call).second;
+				}
+			}
+			stats.add_count("functions imported", num_imported);
+
+			llvm::LLVMContext context;
+			std::unique_ptr<llvm::Module> llvm_module = parse_bitcode(file, context);
+			Emitter emitter(options, stats);
+			Builder builder(options, stats);
+			for (auto& import : imports) {
+				builder.import_functions(*llvm_module, parse_bitcode(*import.first, context),
+				                         import.second);
+			}
+			builder.optimize_imported(*llvm_module, emitter);
+			const std::string& name = file.out_filename;
+			objects[i] = name.substr(0, name.size() - 2) + "thin.o";
+			emitter.emit_object(*llvm_module, objects[i]);
+		}
+	});
+	link_objects(objects);
+}
+
+// the objects are linked with the runtime by the system linker
+void Compiler::link_objects(const std::vector<std::string>& objects) {
+	std::string command = "clang -o " + (out_exec.empty() ? "out" : out_exec);
+	if (!options.target.empty()) command += " -target " + options.target;
+	for (const std::string& object : objects) {
+		command += " \"" + object + "\"";
+	}
+	command += " " + options.runtime;
+	Timer timer(stats, "link objects");
+	if (exec(command.c_str()) != 0) throw Except("Linking failed: " + command);
+}
+
+std::unique_ptr<llvm::Module> Compiler::parse_bitcode(File& file, llvm::LLVMContext& context) {
+	std::unique_ptr<llvm::MemoryBuffer> buffer(llvm::MemoryBuffer::getMemBuffer(
+			file.bitcode, file.out_filename, false));
+	std::string error;
+	std::unique_ptr<llvm::Module> llvm_module(
+			llvm::ParseBitcodeFile(buffer.get(), context, &error));
+	if (llvm_module == nullptr) {
+		throw Except("Could not read '" + file.out_filename + "': " + error);
+	}
+	return llvm_module;
+}
+
+std::unique_ptr<llvm::Module> Compiler::link_modules(llvm::LLVMContext& context) {
+	std::unique_ptr<llvm::Module> mass(new llvm::Module("eb-mass", context));
+	llvm::Linker linker(mass.get());
+	for (auto& file : files) {
+		Timer timer(stats, "link");
+		std::unique_ptr<llvm::Module> llvm_module = parse_bitcode(*file, context);
+		std::string error;
+		if (linker.linkInModule(llvm_module.get(), llvm::Linker::DestroySource, &error)) {
+			throw Except("Could not link '" + file->out_filename + "': " + error);
+		}
+	}
+	return mass;
+}
+
+// the old pipeline, round-trips through textual ir and three external tools
+void Compiler::link_external() {
 	std::string command("llvm-link -o \"eb-mass.ll\" -S ");
 	for (auto& file : files) {
-		command += file->out_filename + " ";
+		// the .ll file name, as bitcode
+		const std::string& name = file->out_filename;
+		std::string bc_filename = name.substr(0, name.size() - 2) + "bc";
+		std::ofstream(bc_filename, std::ofstream::binary) << file->bitcode;
+		command += bc_filename + " ";
 	}
 	//std::cout << command << std::endl;
 	exec(command.c_str());
@@ -26,54 +188,211 @@ Compiler::Compiler(const std::string& filename, std::string out_build, std::stri
 
 	std::string out_s = concat_paths(out_build, "out.s");
 	command = "llc -o " + out_s + " \"eb-mass\".ll";
+	if (!options.target.empty())   command += " -mtriple=" + options.target;
+	if (!options.cpu.empty())      command += " -mcpu=" + options.cpu;
+	if (!options.features.empty()) command += " -mattr=" + options.features;
 	//std::cout << command << std::endl;
 	exec(command.c_str());
 
-	command = "clang -o " + (out_exec.empty() ? "out" : out_exec) + " " + out_s + " shim.a";
+	command = "clang -o " + (out_exec.empty() ? "out" : out_exec) + " " + out_s + " " +
+	          options.runtime;
 	//std::cout << command << std::endl;
 	exec(command.c_str());
 }
 
+// runs each file on the pool once everything it includes is done
+void Compiler::compile_all() {
+	// shards of one file are built on several threads too, even with a single job
+	if (options.jobs != 1 || options.function_threads() > 1) llvm::llvm_start_multithreaded();
+	{
+		ThreadPool pool(options.jobs);
+		for (auto& file : files) {
+			file->pending = file->dependencies.size();
+			for (File* dependency : file->dependencies) {
+				dependency->dependents.push_back(file.get());
+			}
+		}
+		for (auto& file : files) {
+			if (file->pending == 0) schedule(pool, *file);
+		}
+		pool.wait();
+	}
+
+	// files in an include cycle never became ready
+	for (auto& file : files) {
+		compile(*file);
+	}
+
+	for (auto& file : files) {
+		Arena& arena = file->module.arena();
+		stats.add_count("arena bytes", arena.bytes_used());
+		stats.add_count("arena objects", arena.objects());
+		stats.add_count("arena blocks", arena.blocks());
+	}
+}
+
+void Compiler::schedule(ThreadPool& pool, File& file) {
+	pool.submit([this, &pool, &file]() {
+		compile(file);
+		// an import may have started it on another thread first
+		await(file);
+		std::vector<File*> ready;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			for (File* dependent : file.dependents) {
+				if (--dependent->pending == 0) ready.push_back(dependent);
+			}
+		}
+		for (File* dependent : ready) {
+			schedule(pool, *dependent);
+		}
+	});
+}
+
 void Compiler::compile(File& file) {
-	if (file.state != File::READY) return;
-	file.state = File::IN_PROGRESS;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (file.state != File::READY) return;
+		file.state = File::IN_PROGRESS;
+		file.owner = std::this_thread::get_id();
+	}
+
+	try {
+		if (!options.force_recompile && load_obj_file(file)) {
+			stats.add_count("files reused", 1);
+		} else {
+			build(file);
+			stats.add_count("files compiled", 1);
+		}
+	} catch (...) {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			file.state = File::FAILED;
+		}
+		file_finished.notify_all();
+		throw;
+	}
 
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		file.state = File::FINISHED;
+	}
+	file_finished.notify_all();
+}
+
+void Compiler::build(File& file) {
 	Parser parser;
 	parser.construct(file.module, file.tokens->get_tokens());
 
-	// perform short circuiting transformations
-	// (replacing || and && with if's when there are side effects)
+	State state(file.module);
 	Circuiter circuiter;
-	circuiter.shorten(file.module);
+	ReturnChecker return_checker;
+	LoopChecker loop_checker;
+	TypeChecker type_checker(std);
+	unsigned num_threads = options.function_threads();
+	PassManager passes(stats, options.fuse_passes, num_threads);
 
+	// declares every item & resolves the types in their signatures,
+	// which function bodies can depend on so it goes first
+	passes.add_module_pass("resolve items", [&](Module& module) {
+		resolve_items(module, state);
+	});
+	// perform short circuiting transformations
+	// (replacing || and && with if's when there are side effects)
+	passes.add_function_pass("shorten", [&](Module& module, Function& func) {
+		circuiter.shorten(module, func);
+	});
 	// transforms expression ifs into regular ifs
 	// checks every returning function returns on all paths
 	// creates implicit returns when possible & necessary
-	ReturnChecker return_checker;
-	return_checker.check(file.module);
-
-	State state(file.module);
-
+	passes.add_function_pass("check returns", [&](Module& module, Function& func) {
+		return_checker.check(module, func);
+	});
 	// checks loops & if the breaks/continues are valid
-	LoopChecker loop_checker;
-	loop_checker.check(file.module, state);
-
+	passes.add_function_pass("check loops", [&](Module& module, Function& func) {
+		loop_checker.check(func, state);
+	});
 	// resolve dependencies
-	std.add_operators(file.module);
-	resolve(file.module, state);
-
+	passes.add_function_pass("resolve", [&](Module& module, Function& func) {
+		resolve(module, func, state);
+	});
 	// infers and checks all the types & finishes resolving functions
-	TypeChecker type_checker(std);
-	type_checker.check(file.module, state);
+	// once everything is resolved the functions only read each other's signatures,
+	// so with more threads each gets a checker and a state of its own
+	std::vector<std::unique_ptr<TypeChecker>> checkers;
+	std::vector<std::unique_ptr<State>> states;
+	if (num_threads > 1) {
+		for (unsigned i = 0; i < num_threads; i++) {
+			checkers.emplace_back(new TypeChecker(std, true));
+			states.emplace_back(new State(file.module));
+		}
+		passes.add_parallel_pass("check types", [&](Module& module, Function& func, unsigned i) {
+			checkers[i]->check(module, func, *states[i]);
+		});
+	} else {
+		passes.add_function_pass("check types", [&](Module& module, Function& func) {
+			type_checker.check(module, func, state);
+		});
+	}
+	// marks the functions that leave memory alone, now that every call has its function
+	PurityChecker purity_checker;
+	passes.add_module_pass("check purity", [&](Module& module) {
+		purity_checker.check(module);
+	});
+	passes.run(file.module);
+	stats.add_count("pure functions", purity_checker.pure_functions());
+	stats.add_ratio("overload cache hits", type_checker.overload_hits(),
+	                type_checker.overload_lookups());
+	for (auto& checker : checkers) {
+		checker->merge_into(file.module);
+		stats.add_ratio("overload cache hits", checker->overload_hits(),
+		                checker->overload_lookups());
+	}
+
+	// every file gets its own context so that files can be built at the same time
+	llvm::LLVMContext context;
+	Emitter emitter(options, stats);
+	Builder builder(options, stats);
+	std::unique_ptr<llvm::Module> llvm_module = builder.build(file.module, state, context, emitter);
+	llvm::raw_string_ostream stream(file.bitcode);
+	llvm::WriteBitcodeToFile(llvm_module.get(), stream);
+	stream.flush();
+	file.summary = Builder::summarize(*llvm_module);
 
-	Builder builder;
-	builder.build(file.module, state, file.out_filename);
+	create_directory(file.out_filename);
+	// generating code changes the module, so it goes after the bitcode is taken
+	// an object left from an earlier build would no longer match the cache entry below
+	if (needs_native_object()) emitter.emit_object(*llvm_module, file.native_filename);
+	else std::remove(file.native_filename.c_str());
 	create_obj_file(file);
+}
 
-	file.state = File::FINISHED;
+// blocks until a file being compiled on another thread is done
+void Compiler::await(File& file, const Token* token) {
+	std::unique_lock<std::mutex> lock(mutex);
+	if (file.state == File::IN_PROGRESS) {
+		// follow what each thread is waiting on, getting back to this one means a cycle
+		auto self = std::this_thread::get_id();
+		File* cur = &file;
+		while (cur != nullptr && cur->state == File::IN_PROGRESS) {
+			if (cur->owner == self) {
+				if (token == nullptr) throw Except("Circular dependency!");
+				throw Except("Circular dependency!", *token);
+			}
+			auto iter = waiting.find(cur->owner);
+			cur = iter == waiting.end() ? nullptr : iter->second;
+		}
+		waiting[self] = &file;
+		file_finished.wait(lock, [&file]() { return file.state != File::IN_PROGRESS; });
+		waiting.erase(self);
+	}
+	if (file.state == File::FAILED) {
+		if (token == nullptr) throw Except("Dependency failed to compile");
+		throw Except("Dependency failed to compile", *token);
+	}
 }
 
-void Compiler::initialize(const std::string& filename, bool force_recompile) {
+void Compiler::initialize(const std::string& filename) {
 	std::string name = get_file_stem(filename);
 	for (int i = 0; i < name.size(); i++){
 		if ((i == 0 && !is_valid_ident_beginning(name[i])) || (i > 0 && !is_valid_ident(name[i]))) {
@@ -81,8 +400,12 @@ void Compiler::initialize(const std::string& filename, bool force_recompile) {
 		}
 	}
 
+	if (files_by_name.count(filename)) return;
 	File* file = new File();
 	files.push_back(std::unique_ptr<File>(file));
+	files_by_name[filename] = file;
+	files_by_module[&file->module] = file;
+	file->filename = filename;
 	file->module.name.push_back(name);
 	file->module.add_import(file->module.name, file->module);
 	file_tree.add(file->module.name, *file);
@@ -90,24 +413,26 @@ void Compiler::initialize(const std::string& filename, bool force_recompile) {
 	for (auto& str : file->module.name) {
 		out_filename += str + "-";
 	}
+	file->native_filename = concat_paths(out_build, out_filename + ".o");
 	out_filename += ".ll";
 	file->out_filename = concat_paths(out_build, out_filename);
 
-	if (!force_recompile && last_modified(filename) < last_modified(file->out_filename + ".o")) {
-		load_obj_file(*file);
-		file->state = File::FINISHED;
-		return;
-	}
+	{
+		MappedFile source(filename);
+		if (!source.is_open()) throw Except("Could not find '" + filename + "'");
+		file->cache_key = hash_value(options.cache_key(),
+		                             hash_bytes(source.data(), source.size()));
 
-	file->stream.open(filename);
-	if (!file->stream.is_open()) throw Except("Could not find '" + filename + "'");
-	file->tokens.reset(new Tokenizer(file->stream));
+		// the includes are still needed to know what to build, even if this file is reused
+		file->tokens.reset(new Tokenizer(source));
+	}
 	auto& traits = file->tokens->get_traits();
 	for (auto& trait : traits) {
 		switch (trait.first) {
 			case Trait::INCLUDE:
 				file->includes.push_back(trait.second);
 				initialize(trait.second);
+				file->dependencies.push_back(files_by_name[trait.second]);
 				break;
 			case Trait::OUT_EXEC:  out_exec  = trait.second; break;
 			case Trait::OUT_BUILD: out_build = trait.second; break;
@@ -116,6 +441,14 @@ void Compiler::initialize(const std::string& filename, bool force_recompile) {
 }
 
 void Compiler::resolve(Module& module, State& state) {
+	resolve_items(module, state);
+	for (size_t i = 0; i < module.size(); i++) {
+		Item& item = module[i];
+		if (item.form == Item::FUNCTION) resolve(module, (Function&)item, state);
+	}
+}
+
+void Compiler::resolve_items(Module& module, State& state) {
 	for (size_t i = 0; i < module.size(); i++) {
 		Item& item = module[i];
 		switch (item.form) {
@@ -125,7 +458,7 @@ void Compiler::resolve(Module& module, State& state) {
 				for (auto token : import_item.target) {
 					vec.push_back(token->str());
 				}
-				import(module, vec, import_item.token);
+				import(module, state, vec, import_item.token);
 			} break;
 			case Item::GLOBAL: {
 				Global& global = (Global&)item;
@@ -155,32 +488,22 @@ void Compiler::resolve(Module& module, State& state) {
 		switch (item.form) {
 			case Item::IMPORT: break;
 			case Item::GLOBAL: {
-				resolve(module, ((Global&)item).var.type);
+				resolve(module, ((Global&)item).var.type, state);
 			} break;
 			case Item::FUNCTION: {
 				Function& func = (Function&)item;
 				for (Type& type : func.param_types) {
-					resolve(module, type);
+					resolve(module, type, state);
 				}
 				for (Type& type : func.named_param_types) {
-					resolve(module, type);
-				}
-				resolve(module, func.return_type);
-				state.descend(func.block);
-				state.set_func(func);
-				for (size_t j = 0; j < func.param_names.size(); j++) {
-					state.declare(func.param_names[j]->str(), func.param_types[j])->is_param = true;
-				}
-				for (auto pair : func.named_param_map) {
-					state.declare(pair.first, func.named_param_types[pair.second])->is_param = true;
+					resolve(module, type, state);
 				}
-				resolve(module, func.block, state);
-				state.ascend();
+				resolve(module, func.return_type, state);
 			} break;
 			case Item::STRUCT: {
 				Struct& strukt = (Struct&)item;
 				for (Type& type : strukt.member_types) {
-					resolve(module, type);
+					resolve(module, type, state);
 				}
 			} break;
 			case Item::MODULE: {
@@ -190,30 +513,42 @@ void Compiler::resolve(Module& module, State& state) {
 	}
 }
 
+void Compiler::resolve(Module& module, Function& func, State& state) {
+	state.set_func(func);
+	state.descend();
+	for (size_t j = 0; j < func.param_names.size(); j++) {
+		declare_param(state, *func.param_names[j], func.param_types[j]);
+	}
+	for (size_t j = 0; j < func.named_param_names.size(); j++) {
+		declare_param(state, *func.named_param_names[j], func.named_param_types[j]);
+	}
+	resolve(module, func.block, state);
+	state.ascend();
+}
+
 void Compiler::resolve(Module& module, const Block& block, State& state) {
 	for (size_t i = 0; i < block.size(); i++) {
 		Statement& statement = *block[i];
 		switch (statement.form) {
 			case Statement::DECLARATION: {
 				Declaration& decl = (Declaration&)statement;
-				if (decl.type_token == nullptr) {
-					state.declare(statement.token.str(), Type::Invalid);
-				} else {
-					state.declare(statement.token.str(), Type::parse(*decl.type_token));
-					resolve(module, state.get_var(statement.token.str())->type);
+				Type type = Type::Invalid;
+				if (decl.type_token != nullptr) type = Type::parse(*decl.type_token);
+				decl.slot = state.declare(statement.token.symbol(), type);
+				// declaring a name twice in one scope reuses the first variable
+				if (decl.slot == -1) decl.slot = state.lookup(statement.token.symbol()).slot;
+				if (decl.type_token != nullptr) {
+					resolve(module, state.get_func().locals[decl.slot].type, state);
 				}
 			} break;
 			case Statement::ASSIGNMENT: {
 				Assignment& assign = (Assignment&)statement;
-				auto accesses = resolve(module, state, assign.token);
-				for (auto access : accesses) {
-					assign.accesses.push_back(std::unique_ptr<AccessTok>(access));
-				}
+				assign.accesses = resolve(module, state, assign.token, nullptr, &assign.var);
 			} break;
 			default: break;
 		}
 		for (Block* inner_block : statement.blocks()) {
-			state.descend(*inner_block);
+			state.descend();
 			resolve(module, *inner_block, state);
 			state.ascend();
 		}
@@ -221,82 +556,92 @@ void Compiler::resolve(Module& module, const Block& block, State& state) {
 	}
 }
 void Compiler::resolve(Module& module, Expr* expr, State& state) {
-	std::vector<std::pair<Tok*, Tok*>> insertions;
+	std::vector<std::pair<size_t, Tok>> patches;
 	for (size_t i = 0; i < expr->size(); i++) {
-		Tok& tok = *(*expr)[i];
+		Tok& tok = (*expr)[i];
 		if (!(tok.form == Tok::FUNC || tok.form == Tok::VAR)) continue;
-		auto accesses = resolve(module, state, *tok.token, &tok);
-		for (Tok* access : accesses) {
-			insertions.emplace_back(&tok, access);
+		VarRef* var = tok.form == Tok::VAR ? &tok.var : nullptr;
+		for (const Tok& access : resolve(module, state, *tok.token, &tok, var)) {
+			patches.emplace_back(i, access);
 		}
 	}
-	insert(expr, insertions);
+	expr->patch(patches);
 }
 
-std::vector<AccessTok*> Compiler::resolve(Module& module, State& state, const Token& token,
-                                          Tok* tok) {
-	std::vector<AccessTok*> accesses;
+std::vector<Tok> Compiler::resolve(Module& module, State& state, const Token& token, Tok* tok,
+                                   VarRef* var) {
+	std::vector<Tok> accesses;
 	bool on_module = true;
 	Module* cur_module = &module;
-	auto& ident = token.ident();
+	Ident ident = token.ident();
 	for (size_t j = 0; j < ident.size(); j++) {
 		if (j == ident.size() - 1 && tok != nullptr && tok->form == Tok::FUNC) {
-			FuncTok* ftok = (FuncTok*)tok;
 			if (!on_module) throw Except("cant do func on struct yet...");
-			auto& funcs = cur_module->get_functions(ftok->num_unnamed_args, ident[j]);
-			std::vector<Function*> possible_funcs;
+			// operators are never declared in modules, they all come from the one builtin table
+			auto& funcs = token.form == Token::SYMBOL ?
+			              std.get_operators(tok->num_unnamed_args, ident.id(j)) :
+			              cur_module->get_functions(tok->num_unnamed_args, ident.id(j));
+			if (tok->call == nullptr) tok->call = module.arena().make<Call>();
 			for (auto func : funcs) {
-				if (func->pub || j == 0) possible_funcs.push_back(func);
+				if (func->pub || j == 0) tok->call->possible_funcs.push_back(func);
 			}
-			ftok->possible_funcs = possible_funcs;
-			if (cur_module != &module) ftok->external = true;
+			if (cur_module != &module) tok->external = true;
 			break;
 		} else if (j == 0) {
-			Variable* var = state.get_var(ident[j]);
-			if (var != nullptr) {
+			VarRef ref = state.lookup(ident.id(j));
+			if (ref.resolved()) {
 				on_module = false;
-				if (tok != nullptr) dynamic_cast<VarTok*>(tok)->var = var;
+				if (var != nullptr) *var = ref;
 				continue;
 			}
 		}
 		if (on_module) {
-			Global* glob = cur_module->get_global(ident[j]);
+			Global* glob = cur_module->get_global(ident.id(j));
 			if (glob == nullptr) {
-				std::vector<std::string> vec(1, ident[j]);
-				cur_module = cur_module->search(vec);
+				cur_module = j == 0 ? module.search(ident, 1) :
+				             cur_module->search(ident.begin() + j, ident.begin() + j + 1);
 				if (cur_module == nullptr) {
-					cur_module = &import(state.get_module(), vec, token);
+					std::vector<std::string> vec(1, ident[j]);
+					cur_module = &import(state.get_module(), state, vec, token);
 				}
 			} else {
 				if (!glob->pub) throw Except("Can't access private global", token);
 				on_module = false;
+				if (var != nullptr) var->global = &glob->var;
 			}
 		} else {
-			accesses.push_back(new AccessTok(token, ident[j]));
+			accesses.push_back(Tok::make_access(token, ident.id(j)));
 		}
 	}
 	return accesses;
 }
 
-void Compiler::resolve(Module& module, Type& type) {
+void Compiler::declare_param(State& state, const Token& name, Type type) {
+	int slot = state.declare(name.symbol(), type);
+	if (slot == -1) throw Except("Duplicate parameter name", name);
+	state.get_func().locals[slot].is_param = true;
+}
+
+void Compiler::resolve(Module& module, Type& type, State& state) {
 	if (type == Type::Unresolved) {
 		assert(type.token != nullptr);
-		if (type.token->ident().size() > 1) {
+		Ident ident = type.token->ident();
+		if (ident.size() > 1) {
 			// if identifier length not 1, it's assumed to not be in this module
-			auto vec = type.token->ident();
-			vec.pop_back();
-			Module* mod = module.search(vec);
+			Module* mod = module.search(ident, ident.size() - 1);
 			if (mod == nullptr) {
-				mod = &import(module, vec, *type.token);
+				auto vec = ident.strs();
+				vec.pop_back();
+				mod = &import(module, state, vec, *type.token);
 			}
-			Struct* strukt = mod->get_struct(type.token->ident().back());
+			Struct* strukt = mod->get_struct(ident.id(ident.size() - 1));
 			if (strukt == nullptr) throw Except("Couldn't resolve type", *type.token);
 			if (!strukt->pub) throw Except("Can't access private struct", *type.token);
 			type.form = Type::STRUCT;
 			type.strukt = strukt;
 			module.external_items.insert(strukt);
 		} else {
-			Struct* strukt = module.get_struct(type.token->str());
+			Struct* strukt = module.get_struct(type.token->symbol());
 			if (strukt == nullptr) throw Except("Couldn't resolve type", *type.token);
 			type.form = Type::STRUCT;
 			type.strukt = strukt;
@@ -304,184 +649,466 @@ void Compiler::resolve(Module& module, Type& type) {
 	}
 }
 
-Module& Compiler::import(Module& module, const std::vector<std::string>& name, const Token& token) {
+Module& Compiler::import(Module& module, State& state, const std::vector<std::string>& name,
+                         const Token& token) {
 	File* file = file_tree.search(name);
 	if (file == nullptr) {
 		throw Except("Module could not be found", token);
 	}
-	if (file->state == File::READY) {
-		compile(*file);
-	} else if (file->state == File::IN_PROGRESS) {
-		throw Except("Circular dependency!", token);
-	}
+	// compiles it here if no other thread has started on it yet
+	compile(*file);
+	await(*file, &token);
 	module.add_import(name, file->module);
+
+	// remembered so a cached build of the importer can be checked against its interface
+	File& importer = *files_by_module.at(&state.get_module());
+	if (file != &importer &&
+	    std::find(importer.imports.begin(), importer.imports.end(), file) == importer.imports.end()) {
+		importer.imports.push_back(file);
+	}
 	return file->module;
 }
 
 // Obj:
-// [bitcode length, 8], {module bitcode}
-// [num includes]{filename...}
-// [num functions, 4]{(name, return type, [num params, 1], {param type...})...}
-// [num globals, 4]{(const, name, type)...}
+// "eb$", [version, 1]
+// [cache key, 8]: hash of the source and of the options it was built with
+// [num imports, 4]{(filename, [interface hash, 8])...}
+// [interface hash, 8]
+// [bitcode length, 8]{module bitcode}
+// interface (what the interface hash covers), of the file's module and all its submodules:
+// [num submodules, 4]{([parent, 4], pub, name)...}: each after its parent, the file's module is 0
+// [num structs, 4]{([module, 4], pub, name)...}{[num members, 1]{(name, type)...}...}
+// [num functions, 4]{([module, 4], name, unique name, return type, [num params, 1]{type...},
+//                    [num named params, 1]{(name, type, value)...}, [purity, 1])...}
+// [num globals, 4]{([module, 4], const, name, unique name, type, value)...}
+// summary (for thin lto):
+// [num functions, 4]{(unique name, [instructions, 4], [num calls, 4]{unique name...})...}
+// String:
+// [length, 4]{char...}
 // Type:
 // [primitive, 1]
-// S, T, E: (structure, tuple, enum)
+// S, T, E: (structure, tuple, enum), a structure is followed by its module and name
 // *, &, +, ^: references
-void write_type(std::ofstream& out, Type type) {
-	std::unordered_map<Type, char> types = {
+static const char OBJ_VERSION = 4;
+
+template<class T> void write_raw(std::ostream& out, T val) {
+	out.write((const char*)&val, sizeof(T));
+}
+
+// reads an obj file held in memory. reading past the end, or anything that makes no sense,
+// fails the reader instead of throwing, so the file is rebuilt rather than trusted
+class ObjReader {
+public:
+	explicit ObjReader(std::string data) : data(std::move(data)) { }
+	bool good() const { return ok; }
+	void fail() { ok = false; }
+	template<class T> T raw() {
+		T val = T();
+		if (!has(sizeof(T))) return val;
+		memcpy(&val, &data[pos], sizeof(T));
+		pos += sizeof(T);
+		return val;
+	}
+	char get() { return raw<char>(); }
+	std::string bytes(uint64_t len) {
+		if (!has(len)) return std::string();
+		std::string str = data.substr(pos, len);
+		pos += len;
+		return str;
+	}
+	std::string string() { return bytes(raw<uint32_t>()); }
+private:
+	bool has(uint64_t len) {
+		if (len > data.size() - pos) ok = false;
+		return ok;
+	}
+	std::string data;
+	size_t pos = 0;
+	bool ok = true;
+};
+
+void write_string(std::ostream& out, const std::string& str) {
+	write_raw<uint32_t>(out, (uint32_t)str.size());
+	out.write(str.data(), str.size());
+}
+
+void write_type(std::ostream& out, Type type) {
+	static const std::unordered_map<Type, char> types = {
 			{Type::Void, 'v'}, {Type::Bool, 'b'}, {Type::IPtr, 'p'}, {Type::UPtr, 'u'},
-			{Type::I8, 'c'}, {Type::I16, 's'}, {Type::I32, 'i'}, {Type::I32, 'l'},
+			{Type::I8, 'c'}, {Type::I16, 's'}, {Type::I32, 'i'}, {Type::I64, 'l'},
 			{Type::U8, '1'}, {Type::U16, '2'}, {Type::U32, '4'}, {Type::U64, '8'},
 			{Type::Int, 'I'}, {Type::F32, 'f'}, {Type::F64, 'd'}, {Type::Float, 'F'}
 	};
-	auto iter = types.find(type);
-	if (iter == types.end()) {
-		static char invalid = '!';
-		out.write(&invalid, 1);
+	if (type.is_struct()) {
+		out.put('S');
+		const std::string& unique_name = type.strukt->unique_name;
+		size_t dot = unique_name.find_last_of('.');
+		write_string(out, unique_name.substr(0, dot));
+		write_string(out, unique_name.substr(dot + 1));
 		return;
 	}
-	out.write(&iter->second, 1);
+	auto iter = types.find(type);
+	out.put(iter == types.end() ? '!' : iter->second);
 }
-Type read_type(std::ifstream& in) {
-	std::unordered_map<char, Type> types = {
+// structs of the file being loaded are looked up in structs by unique name,
+// as they are not in its modules yet
+Type Compiler::read_type(ObjReader& in, const std::unordered_map<std::string, Struct*>& structs) {
+	static const std::unordered_map<char, Type> types = {
 			{'v', Type::Void}, {'b', Type::Bool}, {'p', Type::IPtr}, {'u', Type::UPtr},
-			{'c', Type::I8}, {'s', Type::I16}, {'i', Type::I32}, {'l', Type::I32},
+			{'c', Type::I8}, {'s', Type::I16}, {'i', Type::I32}, {'l', Type::I64},
 			{'1', Type::U8}, {'2', Type::U16}, {'4', Type::U32}, {'8', Type::U64},
 			{'I', Type::Int}, {'f', Type::F32}, {'d', Type::F64}, {'F', Type::Float}
 	};
-	char c;
-	in.read(&c, 1);
+	char c = in.get();
+	if (c == 'S') {
+		std::string module_name = in.string();
+		std::string name = in.string();
+		Struct* strukt = nullptr;
+		auto iter = structs.find(module_name + "." + name);
+		if (iter != structs.end()) {
+			strukt = iter->second;
+		} else if (Module* owner = find_module(split(module_name, '.'))) {
+			strukt = owner->get_struct(Interner::get().intern(name));
+		}
+		if (strukt != nullptr) return Type(*strukt);
+		in.fail();
+		return Type::Void;
+	}
 	auto iter = types.find(c);
-	assert(iter != types.end());
-	return iter->second;
+	if (iter != types.end()) return iter->second;
+	in.fail();
+	return Type::Void;
 }
-void write_value(std::ofstream& out, Value value) {
-	static char fc = 'f', ic = 'i', bc = 'b';
+// a file's module or one of its submodules, by its whole name
+Module* Compiler::find_module(const std::vector<std::string>& name) {
+	for (size_t len = name.size(); len > 0; len--) {
+		File* file = file_tree.search(std::vector<std::string>(name.begin(), name.begin() + len));
+		if (file == nullptr) continue;
+		Module* module = &file->module;
+		for (size_t i = len; i < name.size() && module != nullptr; i++) {
+			module = module->search(std::vector<std::string>(1, name[i]));
+		}
+		return module;
+	}
+	return nullptr;
+}
+void write_value(std::ostream& out, Value value) {
 	if (value.type.is_float()) {
-		out.write(&fc, 1);
-		uint64_t i = value.i();
-		out.write((char*)&i, sizeof(uint64_t));
+		out.put('f');
+		write_raw<double>(out, value.f());
 	} else if (value.type.is_int()) {
-		out.write(&ic, 1);
-		double f = value.f();
-		out.write((char*)&f, sizeof(double));
+		out.put('i');
+		write_raw<uint64_t>(out, value.i());
 	} else if (value.type == Type::Bool) {
-		out.write(&bc, 1);
-		char b = value.b();
-		out.write(&b, 1);
+		out.put('b');
+		out.put((char)value.b());
+	} else {
+		out.put('n');
 	}
 }
-Value read_value(std::ifstream& in, Type type) {
-	char c;
-	in.read(&c, 1);
+Value read_value(ObjReader& in, Type type) {
+	char c = in.get();
 	if (c == 'f') {
-		double f;
-		in.read((char*)&f, sizeof(double));
-		return Value(f, type);
+		return Value(in.raw<double>(), type);
 	} else if (c == 'i') {
-		uint64_t i;
-		in.read((char*)&i, sizeof(uint64_t));
-		return Value(i, type);
+		return Value(in.raw<uint64_t>(), type);
 	} else if (c == 'b') {
-		char b;
-		in.read(&b, 1);
-		return Value((bool)b);
+		return Value((bool)in.get());
 	}
-	assert(false);
 	return Value();
 }
+
 void Compiler::create_obj_file(File& file) {
-	std::ifstream in(file.out_filename, std::ifstream::ate | std::ifstream::binary);
-	int64_t len = (int64_t)in.tellg();
-	assert(in.good());
-	in.seekg(0, std::ios::beg);
+	std::stringstream interface;
+	// extend can name a module again, or one further down, so only a submodule declared
+	// directly in its parent is taken as its child
+	std::vector<Module*> modules(1, &file.module);
+	std::vector<SubModule*> submodules;
+	std::vector<uint32_t> parents;
+	for (size_t m = 0; m < modules.size(); m++) {
+		for (size_t i = 0; i < modules[m]->size(); i++) {
+			Item& item = (*modules[m])[i];
+			if (item.form != Item::MODULE) continue;
+			Module* submodule = &((SubModule&)item).module;
+			if (modules[m]->search(std::vector<std::string>(1, item.token.str())) != submodule ||
+			    std::find(modules.begin(), modules.end(), submodule) != modules.end()) {
+				continue;
+			}
+			modules.push_back(submodule);
+			submodules.push_back((SubModule*)&item);
+			parents.push_back((uint32_t)m);
+		}
+	}
+	std::vector<std::pair<uint32_t, Struct*>> structs;
+	std::vector<std::pair<uint32_t, Function*>> funcs;
+	std::vector<std::pair<uint32_t, Global*>> globals;
+	for (uint32_t m = 0; m < modules.size(); m++) {
+		for (size_t i = 0; i < modules[m]->size(); i++) {
+			Item& item = (*modules[m])[i];
+			if (item.form == Item::STRUCT) structs.emplace_back(m, (Struct*)&item);
+		}
+		for (Function* func : modules[m]->get_pub_functions()) {
+			// constructors are recreated along with their struct
+			if (func->form == Function::USER) funcs.emplace_back(m, func);
+		}
+		for (Global* global : modules[m]->get_pub_globals()) {
+			globals.emplace_back(m, global);
+		}
+	}
 
-	std::string obj_filename = file.out_filename + ".o";
-	std::ofstream out(obj_filename, std::ifstream::binary);
-	out << 'e' << 'b' << '$';
-	out.write((char*)&len, 8);
-	out << in.rdbuf();
-
-	int32_t num_includes = (int32_t)file.includes.size();
-	out.write((char*)&num_includes, 4);
-	for (auto& filename : file.includes) {
-		out << filename;
-	}
-
-	int32_t num_funcs = (int32_t)file.module.get_pub_functions().size();
-	out.write((char*)&num_funcs, 4);
-	for (Function* func : file.module.get_pub_functions()) {
-		out << func->token.str();
-		write_type(out, func->return_type);
-		uint8_t num_params = (uint8_t)func->param_types.size();
-		out.write((char*)&num_params, 1);
+	write_raw<uint32_t>(interface, (uint32_t)submodules.size());
+	for (size_t i = 0; i < submodules.size(); i++) {
+		write_raw<uint32_t>(interface, parents[i]);
+		interface.put((char)submodules[i]->pub);
+		write_string(interface, submodules[i]->token.str());
+	}
+
+	write_raw<uint32_t>(interface, (uint32_t)structs.size());
+	for (auto& entry : structs) {
+		write_raw<uint32_t>(interface, entry.first);
+		interface.put((char)entry.second->pub);
+		write_string(interface, entry.second->token.str());
+	}
+	for (auto& entry : structs) {
+		Struct* strukt = entry.second;
+		write_raw<uint8_t>(interface, (uint8_t)strukt->member_types.size());
+		for (size_t i = 0; i < strukt->member_types.size(); i++) {
+			write_string(interface, strukt->member_names[i]->str());
+			write_type(interface, strukt->member_types[i]);
+		}
+	}
+
+	write_raw<uint32_t>(interface, (uint32_t)funcs.size());
+	for (auto& entry : funcs) {
+		Function* func = entry.second;
+		write_raw<uint32_t>(interface, entry.first);
+		write_string(interface, func->token.str());
+		write_string(interface, func->unique_name);
+		write_type(interface, func->return_type);
+		write_raw<uint8_t>(interface, (uint8_t)func->param_types.size());
 		for (Type& type : func->param_types) {
-			write_type(out, type);
+			write_type(interface, type);
+		}
+		write_raw<uint8_t>(interface, (uint8_t)func->named_param_types.size());
+		for (size_t i = 0; i < func->named_param_types.size(); i++) {
+			write_string(interface, func->named_param_names[i]->str());
+			write_type(interface, func->named_param_types[i]);
+			write_value(interface, func->named_param_vals[i]);
 		}
+		write_raw<uint8_t>(interface, (uint8_t)func->purity);
+	}
+
+	write_raw<uint32_t>(interface, (uint32_t)globals.size());
+	for (auto& entry : globals) {
+		Global* global = entry.second;
+		write_raw<uint32_t>(interface, entry.first);
+		interface.put((char)global->conzt);
+		write_string(interface, global->token.str());
+		write_string(interface, global->unique_name);
+		write_type(interface, global->var.type);
+		write_value(interface, global->val);
 	}
 
-	int32_t num_globals = (int32_t)file.module.get_pub_globals().size();
-	out.write((char*)&num_globals, 4);
-	for (Global* global : file.module.get_pub_globals()) {
-		char conzt = global->conzt;
-		out.write(&conzt, 1);
-		out << global->token.str();
-		write_type(out, global->var.type);
-		write_value(out, global->val);
+	std::string interface_str = interface.str();
+	file.interface_hash = hash_bytes(interface_str.data(), interface_str.size());
+
+	std::string obj_filename = file.out_filename + ".o";
+	std::ofstream out(obj_filename, std::ofstream::binary);
+	out << 'e' << 'b' << '$' << OBJ_VERSION;
+	write_raw<uint64_t>(out, file.cache_key);
+	write_raw<uint32_t>(out, (uint32_t)file.imports.size());
+	for (File* import : file.imports) {
+		write_string(out, import->filename);
+		write_raw<uint64_t>(out, import->interface_hash);
+	}
+	write_raw<uint64_t>(out, file.interface_hash);
+	write_raw<uint64_t>(out, (uint64_t)file.bitcode.size());
+	out.write(file.bitcode.data(), file.bitcode.size());
+	out.write(interface_str.data(), interface_str.size());
+
+	write_raw<uint32_t>(out, (uint32_t)file.summary.size());
+	for (const FunctionSummary& summary : file.summary) {
+		write_string(out, summary.name);
+		write_raw<uint32_t>(out, summary.size);
+		write_raw<uint32_t>(out, (uint32_t)summary.calls.size());
+		for (const std::string& call : summary.calls) {
+			write_string(out, call);
+		}
 	}
 }
-void Compiler::load_obj_file(File& file) {
+
+// reuses the previous build of a file if neither its source, the options,
+// nor the interface of anything it imported has changed since.
+// nothing is added to the module until the whole file has been read
+bool Compiler::load_obj_file(File& file) {
+	if (needs_native_object() && !file_exists(file.native_filename)) return false;
 	std::string obj_filename = file.out_filename + ".o";
-	std::ifstream in(obj_filename, std::ifstream::binary);
-	char eb[3];
-	in.read(eb, 3);
-	if (std::string(eb, 3) != "eb$") throw Except("Invalid obj file '" + obj_filename + "'");
-	int64_t len;
-	in.read((char*)&len, 8);
-
-	char mem[len]; // TODO: reuse buffer
-	in.read(mem, len);
-	std::ofstream out(file.out_filename);
-	out.write(mem, len);
-
-	int32_t num_includes;
-	in.read((char*)&num_includes, 4);
-	for (size_t i = 0; i < num_includes; i++) {
-		std::string filename;
-		in >> filename;
-		initialize(filename, true);
-	}
-
-	int32_t num_funcs;
-	in.read((char*)&num_funcs, 4);
-	for (size_t i = 0; i < num_funcs; i++) {
-		std::string func_name;
-		in >> func_name;
-		extra_tokens.push_back(Token(Token::IDENT, func_name));
-		Function* func = new Function(extra_tokens.back());
-		func->return_type = read_type(in);
-		uint8_t num_params;
-		in.read((char*)&num_params, 1);
-		for (size_t j = 0; j < num_params; j++) {
-			func->param_types.push_back(read_type(in));
-			std::string param_name = "eb$p" + j;
-			extra_tokens.push_back(Token(Token::IDENT, param_name));
-			func->param_names.push_back(&extra_tokens.back());
-		}
-		extra_functions.push_back(std::unique_ptr<Function>(func));
-	}
-
-	int32_t num_globals;
-	in.read((char*)&num_globals, 4);
-	for (size_t i = 0; i < num_globals; i++) {
-		char conzt;
-		in.read(&conzt, 1);
-		std::string global_name;
-		in >> global_name;
-		extra_tokens.push_back(Token(Token::IDENT, global_name));
-		Type type = read_type(in);
-		Value val = read_value(in, type);
-		Global* global = new Global(extra_tokens.back(), type, val, conzt);
-		extra_globals.push_back(std::unique_ptr<Global>(global));
+	std::ifstream stream(obj_filename, std::ifstream::binary);
+	if (!stream.is_open()) return false;
+	std::stringstream buffer;
+	buffer << stream.rdbuf();
+	ObjReader in(buffer.str());
+	if (in.bytes(3) != "eb$" || in.get() != OBJ_VERSION) return false;
+	if (in.raw<uint64_t>() != file.cache_key) return false;
+
+	uint32_t num_imports = in.raw<uint32_t>();
+	std::vector<File*> imports;
+	for (uint32_t i = 0; i < num_imports && in.good(); i++) {
+		std::string filename = in.string();
+		uint64_t interface_hash = in.raw<uint64_t>();
+		auto iter = files_by_name.find(filename);
+		if (!in.good() || iter == files_by_name.end()) return false;
+		File& import = *iter->second;
+		compile(import);
+		await(import);
+		if (import.interface_hash != interface_hash) return false;
+		imports.push_back(&import);
+	}
+	uint64_t interface_hash = in.raw<uint64_t>();
+	std::string bitcode = in.bytes(in.raw<uint64_t>());
+
+	Module& module = file.module;
+	Arena& arena = module.arena();
+	auto make_token = [&arena](const std::string& str) -> Token& {
+		return *arena.make<Token>(Token::IDENT, str);
+	};
+
+	// the submodules are only created once everything is read, until then they're just names
+	uint32_t num_submodules = in.raw<uint32_t>();
+	std::vector<std::string> module_names(1, combine(module.name, "."));
+	std::vector<uint32_t> parents;
+	std::vector<std::pair<bool, std::string>> submodules;
+	for (uint32_t i = 0; i < num_submodules && in.good(); i++) {
+		uint32_t parent = in.raw<uint32_t>();
+		bool pub = (bool)in.get();
+		std::string name = in.string();
+		if (parent >= module_names.size()) return false;
+		std::string module_name = module_names[parent] + "." + name;
+		if (std::find(module_names.begin(), module_names.end(), module_name) != module_names.end() ||
+		    (parent == 0 && module.search(std::vector<std::string>(1, name)) != nullptr)) {
+			return false;
+		}
+		module_names.push_back(module_name);
+		parents.push_back(parent);
+		submodules.emplace_back(pub, name);
+	}
+	auto read_module = [&]() -> uint32_t {
+		uint32_t index = in.raw<uint32_t>();
+		if (index >= module_names.size()) in.fail();
+		return in.good() ? index : 0;
+	};
+
+	uint32_t num_structs = in.raw<uint32_t>();
+	std::vector<std::pair<uint32_t, Struct*>> structs;
+	std::unordered_map<std::string, Struct*> structs_by_name;
+	for (uint32_t i = 0; i < num_structs && in.good(); i++) {
+		uint32_t index = read_module();
+		bool pub = (bool)in.get();
+		Struct* strukt = arena.make<Struct>(make_token(in.string()));
+		strukt->pub = pub;
+		strukt->unique_name = module_names[index] + "." + strukt->token.str();
+		structs.emplace_back(index, strukt);
+		structs_by_name[strukt->unique_name] = strukt;
+	}
+	for (auto& entry : structs) {
+		Struct* strukt = entry.second;
+		uint8_t num_members = in.raw<uint8_t>();
+		for (uint8_t j = 0; j < num_members && in.good(); j++) {
+			Token& member = make_token(in.string());
+			strukt->add_member(member, read_type(in, structs_by_name));
+		}
+		Function* constructor = arena.make<Function>(strukt->token);
+		constructor->pub = strukt->pub;
+		for (size_t j = 0; j < strukt->member_types.size(); j++) {
+			constructor->add_named_param(*strukt->member_names[j], strukt->member_types[j]);
+		}
+		constructor->return_type = Type(*strukt);
+		constructor->form = Function::CONSTRUCTOR;
+		strukt->constructor = constructor;
+	}
+
+	uint32_t num_funcs = in.raw<uint32_t>();
+	std::vector<std::pair<uint32_t, Function*>> funcs;
+	for (uint32_t i = 0; i < num_funcs && in.good(); i++) {
+		uint32_t index = read_module();
+		Function* func = arena.make<Function>(make_token(in.string()));
+		func->pub = true;
+		func->unique_name = in.string();
+		func->return_type = read_type(in, structs_by_name);
+		uint8_t num_params = in.raw<uint8_t>();
+		for (uint8_t j = 0; j < num_params && in.good(); j++) {
+			std::stringstream param_name;
+			param_name << "eb$p" << (int)j;
+			func->add_param(make_token(param_name.str()), read_type(in, structs_by_name));
+		}
+		uint8_t num_named_params = in.raw<uint8_t>();
+		for (uint8_t j = 0; j < num_named_params && in.good(); j++) {
+			Token& name = make_token(in.string());
+			Type type = read_type(in, structs_by_name);
+			func->add_named_param(name, type, read_value(in, type));
+		}
+		uint8_t purity = in.raw<uint8_t>();
+		if (purity > Function::WRITES) in.fail();
+		func->purity = (Function::Purity)purity;
+		funcs.emplace_back(index, func);
+	}
+
+	uint32_t num_globals = in.raw<uint32_t>();
+	std::vector<std::pair<uint32_t, Global*>> globals;
+	for (uint32_t i = 0; i < num_globals && in.good(); i++) {
+		uint32_t index = read_module();
+		bool conzt = (bool)in.get();
+		Token& name = make_token(in.string());
+		std::string unique_name = in.string();
+		Type type = read_type(in, structs_by_name);
+		Global* global = arena.make<Global>(name, type, read_value(in, type), conzt);
+		global->pub = true;
+		global->unique_name = unique_name;
+		globals.emplace_back(index, global);
+	}
+
+	std::vector<FunctionSummary> summaries;
+	uint32_t num_summaries = in.raw<uint32_t>();
+	for (uint32_t i = 0; i < num_summaries && in.good(); i++) {
+		FunctionSummary summary;
+		summary.name = in.string();
+		summary.size = in.raw<uint32_t>();
+		uint32_t num_calls = in.raw<uint32_t>();
+		for (uint32_t j = 0; j < num_calls && in.good(); j++) {
+			summary.calls.push_back(in.string());
+		}
+		summaries.push_back(std::move(summary));
+	}
+	if (!in.good()) return false;
+
+	std::vector<Module*> modules(1, &module);
+	for (size_t i = 0; i < submodules.size(); i++) {
+		Module& parent = *modules[parents[i]];
+		Module* submodule = parent.create_submodule(submodules[i].second);
+		assert(submodule != nullptr);
+		SubModule* item = arena.make<SubModule>(make_token(submodules[i].second), *submodule);
+		item->pub = submodules[i].first;
+		parent.push_back(item);
+		modules.push_back(submodule);
+	}
+	for (auto& entry : structs) {
+		modules[entry.first]->push_back(entry.second);
+		modules[entry.first]->declare(*entry.second);
+	}
+	for (auto& entry : structs) {
+		modules[entry.first]->declare(*entry.second->constructor);
+	}
+	for (auto& entry : funcs) {
+		modules[entry.first]->push_back(entry.second);
+		modules[entry.first]->declare(*entry.second);
+	}
+	for (auto& entry : globals) {
+		modules[entry.first]->push_back(entry.second);
+		modules[entry.first]->declare(*entry.second);
 	}
+	file.imports = imports;
+	file.interface_hash = interface_hash;
+	file.bitcode = std::move(bitcode);
+	file.summary = std::move(summaries);
+	return true;
 }
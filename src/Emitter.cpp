@@ -0,0 +1,168 @@
+#include "Emitter.h"
+#include "Except.h"
+#include "llvm/ExecutionEngine/ExecutionEngine.h"
+#include "llvm/ExecutionEngine/MCJIT.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/DataLayout.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/Triple.h"
+#include "llvm/MC/SubtargetFeature.h"
+#include "llvm/PassManager.h"
+#include "llvm/Support/FormattedStream.h"
+#include "llvm/Support/Host.h"
+#include "llvm/Support/TargetRegistry.h"
+#include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/ToolOutputFile.h"
+#include "llvm/Target/TargetMachine.h"
+#include "llvm/Target/TargetOptions.h"
+#include <mutex>
+#include <sstream>
+
+static llvm::CodeGenOpt::Level codegen_level(int opt_level) {
+	switch (opt_level) {
+		case 0:  return llvm::CodeGenOpt::None;
+		case 1:  return llvm::CodeGenOpt::Less;
+		case 2:  return llvm::CodeGenOpt::Default;
+		default: return llvm::CodeGenOpt::Aggressive;
+	}
+}
+
+// the registries aren't thread safe, and files are built on several threads at once
+static void initialize_targets(bool all) {
+	static std::once_flag native_flag, all_flag;
+	std::call_once(native_flag, []() {
+		llvm::InitializeNativeTarget();
+		llvm::InitializeNativeTargetAsmPrinter();
+	});
+	if (!all) return;
+	std::call_once(all_flag, []() {
+		llvm::InitializeAllTargetInfos();
+		llvm::InitializeAllTargets();
+		llvm::InitializeAllTargetMCs();
+		llvm::InitializeAllAsmPrinters();
+	});
+}
+
+Emitter::Emitter(const Options& options, Stats& stats)
+		: stats(stats), opt_level(options.opt_level), cpu(options.cpu), features(options.features) {
+	initialize_targets(!options.target.empty());
+
+	triple = options.target.empty() ? llvm::sys::getDefaultTargetTriple() :
+	                                  llvm::Triple::normalize(options.target);
+	std::string error;
+	const llvm::Target* target = llvm::TargetRegistry::lookupTarget(triple, error);
+	if (target == nullptr) throw Except(error);
+
+	if (cpu == "native") {
+		cpu = llvm::sys::getHostCPUName().str();
+		// not every host can list them, the cpu name alone implies most
+		llvm::StringMap<bool> host_features;
+		if (features.empty() && llvm::sys::getHostCPUFeatures(host_features)) {
+			llvm::SubtargetFeatures list;
+			for (auto& feature : host_features) {
+				list.AddFeature(feature.getKey().str(), feature.getValue());
+			}
+			features = list.getString();
+		}
+	}
+
+	llvm::TargetOptions target_options;
+	machine.reset(target->createTargetMachine(triple, cpu, features, target_options,
+	                                          llvm::Reloc::Default, llvm::CodeModel::Default,
+	                                          codegen_level(opt_level)));
+	if (machine == nullptr) throw Except("Could not create target machine for '" + triple + "'");
+	ptr_bits = machine->getDataLayout()->getPointerSizeInBits();
+
+	// as the target's c compilers lay it out, everywhere else it is just a double
+	llvm::Triple target_triple(triple);
+	switch (target_triple.getArch()) {
+		case llvm::Triple::x86: case llvm::Triple::x86_64:
+			if (target_triple.getOS() != llvm::Triple::Win32) long_double = X86_FP80;
+			break;
+		case llvm::Triple::aarch64: case llvm::Triple::mips64: case llvm::Triple::mips64el:
+		case llvm::Triple::sparcv9: case llvm::Triple::systemz:
+			long_double = FP128;
+			break;
+		case llvm::Triple::ppc: case llvm::Triple::ppc64:
+			long_double = PPC_FP128;
+			break;
+		default: break;
+	}
+}
+
+Emitter::~Emitter() { }
+
+llvm::Type* Emitter::long_double_type(llvm::LLVMContext& context) const {
+	switch (long_double) {
+		case X86_FP80:  return llvm::Type::getX86_FP80Ty(context);
+		case FP128:     return llvm::Type::getFP128Ty(context);
+		case PPC_FP128: return llvm::Type::getPPC_FP128Ty(context);
+		default:        return llvm::Type::getDoubleTy(context);
+	}
+}
+
+void Emitter::prepare(llvm::Module& module) const {
+	module.setTargetTriple(triple);
+	module.setDataLayout(machine->getDataLayout()->getStringRepresentation());
+}
+
+void Emitter::add_analysis_passes(llvm::PassManagerBase& pass_manager) const {
+	pass_manager.add(new llvm::DataLayout(*machine->getDataLayout()));
+	machine->addAnalysisPasses(pass_manager);
+}
+
+void Emitter::emit_object(llvm::Module& module, const std::string& filename) {
+	Timer timer(stats, "emit object");
+	prepare(module);
+
+	std::string error;
+	llvm::tool_output_file out(filename.c_str(), error, llvm::sys::fs::F_Binary);
+	if (!error.empty()) throw Except("Could not open '" + filename + "': " + error);
+
+	{
+		llvm::PassManager pass_manager;
+		pass_manager.add(new llvm::DataLayout(*machine->getDataLayout()));
+		llvm::formatted_raw_ostream stream(out.os());
+		if (machine->addPassesToEmitFile(pass_manager, stream,
+		                                 llvm::TargetMachine::CGFT_ObjectFile)) {
+			throw Except("Target '" + triple + "' can't emit object files");
+		}
+		pass_manager.run(module);
+	}
+	out.keep();
+}
+
+int Emitter::run(std::unique_ptr<llvm::Module> module) {
+	llvm::Function* main_func = module->getFunction("eb$main");
+	if (main_func == nullptr) throw Except("No main function to run");
+
+	if (llvm::Triple(triple).getArch() != llvm::Triple(llvm::sys::getProcessTriple()).getArch()) {
+		throw Except("Can't run code built for '" + triple + "' here");
+	}
+
+	std::string error;
+	std::unique_ptr<llvm::ExecutionEngine> engine;
+	{
+		Timer timer(stats, "jit");
+		std::vector<std::string> attrs;
+		std::stringstream list(features);
+		for (std::string attr; std::getline(list, attr, ',');) {
+			if (!attr.empty()) attrs.push_back(attr);
+		}
+		// the engine takes ownership of the module
+		engine.reset(llvm::EngineBuilder(module.release())
+				             .setErrorStr(&error)
+				             .setUseMCJIT(true)
+				             .setOptLevel(codegen_level(opt_level))
+				             .setMCPU(cpu)
+				             .setMAttrs(attrs)
+				             .create());
+		if (engine == nullptr) throw Except("Could not create jit: " + error);
+		engine->finalizeObject();
+	}
+
+	auto eb_main = (int (*)())engine->getPointerToFunction(main_func);
+	if (eb_main == nullptr) throw Except("Could not jit main");
+	Timer timer(stats, "run");
+	return eb_main();
+}
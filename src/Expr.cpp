@@ -1,4 +1,6 @@
 #include "ast/Expr.h"
+#include <algorithm>
+#include <cassert>
 
 bool Value::b(const Token& token) const {
 	if (!type == Type::Bool) throw ("Expected boolean", token);
@@ -28,38 +30,62 @@ double Value::f() const {
 }
 
 
-void insert(Expr* expr, std::vector<std::pair<Tok*, Tok*>>& insertions) {
-	if (!insertions.empty()) {
-		size_t i = 0;
-		Expr new_expr;
-		for (auto& utok : *expr) {
-			Tok& tok = *utok;
-			new_expr.emplace_back();
-			new_expr.back().swap(utok);
-			if (i < insertions.size() && &tok == insertions[i].first) {
-				do {
-					new_expr.push_back(std::unique_ptr<Tok>(insertions[i].second));
-					i++;
-				} while (i < insertions.size() && insertions[i - 1].first == insertions[i].first);
-			}
-		}
-		assert(i == insertions.size());
-		*expr = std::move(new_expr);
+Tok Tok::make_value(const Token& token, Value value) {
+	Tok tok(token, VALUE);
+	tok.value = value;
+	if (value.type == Type::Invalid) tok.value.type = Type(token.suffix);
+	return tok;
+}
+Tok Tok::make_var(const Token& token) {
+	return Tok(token, VAR);
+}
+Tok Tok::make_func(const Token& token, int num_args, Call* call) {
+	Tok tok(token, FUNC);
+	tok.num_args = (uint16_t)num_args;
+	tok.num_unnamed_args = (uint16_t)num_args;
+	tok.call = call;
+	return tok;
+}
+Tok Tok::make_if(const Token& token, If* if_statement) {
+	Tok tok(token, IF);
+	tok.if_statement = if_statement;
+	return tok;
+}
+Tok Tok::make_access(const Token& token, uint32_t name) {
+	Tok tok(token, ACCESS);
+	tok.member.name = name;
+	tok.member.idx = -1;
+	return tok;
+}
+
+
+void Expr::splice(size_t pos, size_t count, const Tok* new_toks, size_t num) {
+	assert(pos + count <= toks.size());
+	std::copy(new_toks, new_toks + std::min(count, num), toks.begin() + pos);
+	if (num > count) {
+		toks.insert(toks.begin() + pos + count, new_toks + count, new_toks + num);
+	} else if (count > num) {
+		toks.erase(toks.begin() + pos + num, toks.begin() + pos + count);
 	}
 }
 
-void insert(Expr* expr, std::map<Tok*, Tok*>& insertions) {
-	if (!insertions.empty()) {
-		Expr new_expr;
-		for (auto& utok : *expr) {
-			Tok& tok = *utok;
-			new_expr.emplace_back();
-			new_expr.back().swap(utok);
-			auto iter = insertions.find(&tok);
-			if (iter != insertions.end()) {
-				new_expr.push_back(std::unique_ptr<Tok>(iter->second));
-			}
+void Expr::patch(std::vector<std::pair<size_t, Tok>>& patches) {
+	if (patches.empty()) return;
+	std::stable_sort(patches.begin(), patches.end(),
+	                 [](const std::pair<size_t, Tok>& a, const std::pair<size_t, Tok>& b) {
+		return a.first < b.first;
+	});
+	assert(patches.back().first < toks.size());
+	size_t old_size = toks.size();
+	toks.resize(old_size + patches.size(), toks.front());
+	// walk from the back so every node is moved once, straight to where it ends up
+	size_t dst = toks.size();
+	size_t p = patches.size();
+	for (size_t src = old_size; src-- > 0 && p > 0;) {
+		while (p > 0 && patches[p - 1].first == src) {
+			toks[--dst] = patches[--p].second;
 		}
-		*expr = std::move(new_expr);
+		toks[--dst] = toks[src];
 	}
+	assert(p == 0);
 }
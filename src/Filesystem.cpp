@@ -1,5 +1,7 @@
 #include "Filesystem.h"
 #include <util/Util.h>
+#include <fstream>
+#include <sys/stat.h>
 
 #if _WIN32
 #include <direct.h>
@@ -8,11 +10,14 @@
 const char FILE_SEPARATOR = '\\';
 #else
 #include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
 #define CREATE_DIR(s) mkdir(s, S_IRWXU | S_IRWXG | S_IROTH | S_IXOTH)
 const char FILE_SEPARATOR = '/';
 #endif
 
 std::string concat_paths(const std::string& dir, const std::string& path2) {
+	if (dir.empty()) return path2;
 	bool dir_s = !dir.empty() && dir.back() == FILE_SEPARATOR;
 	bool p2_s  = !path2.empty() && path2[0] == FILE_SEPARATOR;
 	if (dir_s != p2_s) return dir + path2;
@@ -94,3 +99,40 @@ void create_directory(const std::string& filename) {
 bool change_directory(const std::string& directory) {
 	return chdir(directory.c_str()) == 0;
 }
+
+MappedFile::MappedFile(const std::string& filename) {
+#if _WIN32
+	std::ifstream file(filename, std::ifstream::binary);
+	if (!file.is_open()) return;
+	buffer.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	ptr = buffer.data();
+	length = buffer.size();
+	opened = true;
+#else
+	int fd = open(filename.c_str(), O_RDONLY);
+	if (fd == -1) return;
+	struct stat st;
+	if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode)) {
+		opened = true;
+		length = (size_t)st.st_size;
+		// an empty file can't be mapped, it is left as ""
+		if (length > 0) {
+			void* addr = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (addr != MAP_FAILED) {
+				ptr = (const char*)addr;
+				mapped = true;
+			} else {
+				opened = false;
+				length = 0;
+			}
+		}
+	}
+	close(fd);
+#endif
+}
+
+MappedFile::~MappedFile() {
+#if !_WIN32
+	if (mapped) munmap((void*)ptr, length);
+#endif
+}
@@ -0,0 +1,49 @@
+#include "Interner.h"
+#include "Util.h"
+
+Interner& Interner::get() {
+	static Interner interner;
+	return interner;
+}
+
+Interner::Interner() {
+	// id 0 is the empty string, which default tokens refer to
+	intern("", 0);
+}
+
+size_t Interner::KeyHash::operator()(const Key& key) const {
+	return (size_t)hash_bytes(key.data, key.len);
+}
+size_t Interner::RangeKeyHash::operator()(const RangeKey& key) const {
+	return (size_t)hash_bytes((const char*)key.ids, key.count * sizeof(uint32_t));
+}
+
+uint32_t Interner::intern(const char* data, size_t len) {
+	std::lock_guard<std::mutex> lock(mutex);
+	auto iter = ids.find(Key{data, len});
+	if (iter != ids.end()) return iter->second;
+
+	uint32_t id = strings.reserve(1);
+	std::string& str = strings.at(id);
+	str.assign(data, len);
+	ids.emplace(Key{str.data(), str.size()}, id);
+	return id;
+}
+
+uint32_t Interner::add_range(const uint32_t* ids, size_t count) {
+	std::lock_guard<std::mutex> lock(mutex);
+	auto iter = range_ids.find(RangeKey{ids, count});
+	if (iter != range_ids.end()) return iter->second;
+
+	uint32_t start = ranges.reserve(count);
+	for (size_t i = 0; i < count; i++) {
+		ranges.at(start + (uint32_t)i) = ids[i];
+	}
+	range_ids.emplace(RangeKey{&ranges.at(start), count}, start);
+	return start;
+}
+
+size_t Interner::size() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return ids.size();
+}
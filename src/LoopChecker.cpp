@@ -6,25 +6,21 @@ void LoopChecker::check(Module& module, State& state) {
 		Item& item = module[i];
 		switch (item.form) {
 			case Item::FUNCTION: {
-				Function& func = (Function&)item;
-				check(func.block, state);
+				check((Function&)item, state);
 			} break;
 			default: break;
 		}
 	}
 }
 
+void LoopChecker::check(Function& func, State& state) {
+	check(func.block, state);
+}
+
 void LoopChecker::check(Block& block, State& state) {
-	state.descend(block);
 	for (size_t i = 0; i < block.size(); i++) {
 		Statement& statement = *block[i];
-		const Token& token = statement.token;
 		switch (statement.form) {
-			case Statement::WHILE: {
-				state.descend(((While&)statement).block);
-				state.create_loop();
-				state.ascend();
-			} break;
 			case Statement::CONTINUE:
 				if (state.get_loop(1) == nullptr) {
 					throw Except("No loop to continue", statement.token);
@@ -35,9 +31,11 @@ void LoopChecker::check(Block& block, State& state) {
 				} break;
 			default: break;
 		}
+		bool loop = statement.form == Statement::WHILE;
+		if (loop) state.push_loop();
 		for (Block* inner_block : statement.blocks()) {
 			check(*inner_block, state);
 		}
+		if (loop) state.pop_loop();
 	}
-	state.ascend();
 }
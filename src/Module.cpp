@@ -2,61 +2,53 @@
 
 bool Module::declare(Function& func) {
 	if (func.pub) pub_functions.push_back(&func);
-	auto key = std::make_pair(func.token.str(), func.param_names.size());
-	auto iter = functions.find(key);
-	if (iter == functions.end()) {
-		std::vector<Function*> vec;
-		vec.push_back(&func);
-		functions[key] = vec;
-	} else {
-		for (Function* f : iter->second) {
-			if (f->param_types == func.param_types) {
-				return true;
-			}
+	auto& overloads = functions[functions.key(func.token.symbol(), func.param_names.size())];
+	for (Function* f : overloads) {
+		if (f->param_types == func.param_types) {
+			return true;
 		}
-		func.index = (int)iter->second.size();
-		iter->second.push_back(&func);
 	}
+	func.index = (int)overloads.size();
+	overloads.push_back(&func);
 	return false;
 }
-const std::vector<Function*>& Module::get_functions(int num_params, const std::string& name) const {
-	auto key = std::make_pair(name, num_params);
-	auto iter = functions.find(key);
-	if (iter == functions.end()) {
+const std::vector<Function*>& Module::get_functions(int num_params, uint32_t name) const {
+	auto overloads = functions.find(functions.key(name, (uint32_t)num_params));
+	if (overloads == nullptr) {
 		static std::vector<Function*> empty;
 		return empty;
 	}
-	return iter->second;
+	return *overloads;
 }
 const std::vector<Function*>& Module::get_pub_functions() const {
 	return pub_functions;
 }
 
 bool Module::declare(Global& global) {
-	if (globals.count(global.token.str())) return true;
+	Global*& slot = globals[global.token.symbol()];
+	if (slot != nullptr) return true;
 	if (global.pub) pub_globals.push_back(&global);
-	globals[global.token.str()] = &global;
+	slot = &global;
 	return false;
 }
-Global* Module::get_global(const std::string& name) {
-	auto iter = globals.find(name);
-	if (iter == globals.end()) return nullptr;
-	return iter->second;
+Global* Module::get_global(uint32_t name) {
+	auto global = globals.find(name);
+	return global == nullptr ? nullptr : *global;
 }
 const std::vector<Global*>& Module::get_pub_globals() const {
 	return pub_globals;
 }
 
 bool Module::declare(Struct& strukt) {
-	if (structs.count(strukt.token.str())) return true;
+	Struct*& slot = structs[strukt.token.symbol()];
+	if (slot != nullptr) return true;
 	if (strukt.pub) pub_structs.push_back(&strukt);
-	structs[strukt.token.str()] = &strukt;
+	slot = &strukt;
 	return false;
 }
-Struct* Module::get_struct(const std::string& name) {
-	auto iter = structs.find(name);
-	if (iter == structs.end()) return nullptr;
-	return iter->second;
+Struct* Module::get_struct(uint32_t name) {
+	auto strukt = structs.find(name);
+	return strukt == nullptr ? nullptr : *strukt;
 }
 const std::vector<Struct*>& Module::get_pub_structs() const {
 	return pub_structs;
@@ -64,14 +56,18 @@ const std::vector<Struct*>& Module::get_pub_structs() const {
 
 Module* Module::create_submodule(const std::string& name) {
 	submodules.push_back(std::unique_ptr<Module>(new Module()));
+	submodules.back()->arena_ptr = arena_ptr;
+	// named by its whole path, so what it holds gets unique names apart from the parent's
+	submodules.back()->name = this->name;
+	submodules.back()->name.push_back(name);
 	std::vector<std::string> vec(1, name);
 	bool success = imports.add(vec, *submodules.back());
 	if (!success) return nullptr;
 	return &*submodules.back();
 }
 
-void Module::push_back(std::unique_ptr<Item> item) {
-	return items.push_back(std::move(item));
+void Module::push_back(Item* item) {
+	items.push_back(item);
 }
 size_t Module::size() const {
 	return items.size();
@@ -86,7 +82,18 @@ const Item& Module::operator[](size_t index) const {
 bool Module::add_import(const std::vector<std::string>& module_name, Module& module) {
 	return imports.add(module_name, module);
 }
-Module* Module::search(const std::vector<std::string>& module_name) {
+Module* Module::search(const std::vector<std::string>& module_name) const {
 	return imports.search(module_name);
 }
+Module* Module::search(const uint32_t* begin, const uint32_t* end) const {
+	return imports.search(begin, end);
+}
+Module* Module::search(const Ident& ident, size_t len) {
+	Module** memo = paths.find(ident.path(len));
+	if (memo != nullptr) return *memo;
+	// misses aren't remembered, since the module might be imported later
+	Module* module = imports.search(ident.begin(), ident.begin() + len);
+	if (module != nullptr) paths[ident.path(len)] = module;
+	return module;
+}
 
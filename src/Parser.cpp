@@ -3,6 +3,7 @@
 
 void Parser::construct(Module& module, const std::vector<Token>& tokens) {
 	this->tokens = &tokens;
+	arena = &module.arena();
 	index = 0;
 	do_module(module);
 }
@@ -12,19 +13,18 @@ void Parser::do_module(Module& module, bool submodule) {
 		trim();
 		if (submodule && peek().str() == "}") break;
 		if (index >= tokens->size()) break;
-		auto item = do_item(module);
-		module.push_back(std::move(item));
+		module.push_back(do_item(module));
 	}
 }
 
-std::unique_ptr<Item> Parser::do_item(Module& module) {
+Item* Parser::do_item(Module& module) {
 	const Token* token = &next();
 	bool pub = false;
 	if (token->form == Token::KW_PUB) {
 		pub = true;
 		token = &next();
 	}
-	std::unique_ptr<Item> item;
+	Item* item;
 	if (token->form == Token::KW_FN) {
 		item = do_function();
 	} else if (token->str() == "import") {
@@ -46,8 +46,8 @@ std::unique_ptr<Item> Parser::do_item(Module& module) {
 	return item;
 }
 
-std::unique_ptr<Import> Parser::do_import(const Token& kw) {
-	std::unique_ptr<Import> import(new Import(kw));
+Import* Parser::do_import(const Token& kw) {
+	Import* import = arena->make<Import>(kw);
 	while (true) {
 		const Token& next_token = next();
 		import->target.push_back(&next_token);
@@ -78,10 +78,10 @@ std::unique_ptr<Import> Parser::do_import(const Token& kw) {
 	return import;
 }
 
-std::unique_ptr<Function> Parser::do_function() {
+Function* Parser::do_function() {
 	const Token& name_token = expect_ident();
 	assert_simple_ident(name_token);
-	std::unique_ptr<Function> function(new Function(name_token));
+	Function* function = arena->make<Function>(name_token);
 	expect("(");
 	trim();
 
@@ -130,23 +130,23 @@ std::unique_ptr<Function> Parser::do_function() {
 
 	if (colon_token->str() != "{") throw Except("Expected ':' or '{'", *colon_token);
 	function->block = do_block();
-	return std::move(function);
+	return function;
 }
 
-std::unique_ptr<Global> Parser::do_global(bool conzt) {
+Global* Parser::do_global(bool conzt) {
 	const Token& name = next();
 	expect(":");
 	Type type = Type::parse(expect_ident());
 	expect("=");
 	Expr expr = do_expr("}", true);
-	return std::unique_ptr<Global>(new Global(name, type, eval.eval(type, expr), conzt));
+	return arena->make<Global>(name, type, eval.eval(type, expr), conzt);
 }
 
-std::unique_ptr<Struct> Parser::do_struct(bool pub, Module& module) {
+Struct* Parser::do_struct(bool pub, Module& module) {
 	const Token& name_token = expect_ident();
 	expect("{");
 	trim();
-	std::unique_ptr<Struct> strukt(new Struct(name_token));
+	Struct* strukt = arena->make<Struct>(name_token);
 
 	const Token* member_token = &next();
 	while (member_token->str() != "}") {
@@ -164,34 +164,37 @@ std::unique_ptr<Struct> Parser::do_struct(bool pub, Module& module) {
 
 	Module* submodule = module.create_submodule(name_token.str());
 	if (submodule == nullptr) throw Except("Module redeclaration", name_token);
-	std::unique_ptr<Item> item(new SubModule(name_token, *submodule));
+	Item* item = arena->make<SubModule>(name_token, *submodule);
 	item->pub = pub;
 	module.push_back(std::move(item));
 
-	Function* constructor = new Function(name_token);
+	Function* constructor = arena->make<Function>(name_token);
 	constructor->pub = pub;
 	for (size_t i = 0; i < strukt->member_types.size(); i++) {
 		constructor->add_named_param(*strukt->member_names[i], strukt->member_types[i]);
 	}
 	constructor->return_type = Type(*strukt);
 	constructor->form = Function::CONSTRUCTOR;
-	strukt->constructor.reset(constructor);
+	strukt->constructor = constructor;
 	module.declare(*constructor);
 
-	return std::move(strukt);
+	return strukt;
 }
 
-std::unique_ptr<SubModule> Parser::do_submodule(Module& module, bool extend) {
+SubModule* Parser::do_submodule(Module& module, bool extend) {
 	const Token& name_token = expect_ident();
 	expect("{");
-	Module* submodule = extend ? module.search(name_token.ident()) :
+	Ident ident = name_token.ident();
+	Module* submodule = extend ? module.search(ident, ident.size()) :
 	                             module.create_submodule(name_token.str());
 	if (submodule == nullptr) {
 		throw Except(extend ? "Nonexistant module" : "Module redeclaration", name_token);
 	}
 	do_module(*submodule, true);
-	std::unique_ptr<SubModule> item(new SubModule(name_token, *submodule));
-	return std::move(item);
+	trim();
+	expect("}");
+	SubModule* item = arena->make<SubModule>(name_token, *submodule);
+	return item;
 }
 
 Block Parser::do_block() {
@@ -202,8 +205,7 @@ Block Parser::do_block() {
 			next();
 			break;
 		}
-		auto statement = do_statement();
-		block.push_back(std::move(statement));
+		block.push_back(do_statement());
 	}
 	return block;
 }
@@ -226,7 +228,7 @@ Op EQ(5); Op NEQ(5);
 Op FUNC(-1, -1);
 Op PAREN(-1, -1);
 
-std::unique_ptr<Statement> Parser::do_statement() {
+Statement* Parser::do_statement() {
 	const Token& token = next();
 	switch (token.form) {
 		case Token::IDENT: {
@@ -252,38 +254,36 @@ std::unique_ptr<Statement> Parser::do_statement() {
 		case Token::KW_RETURN: return do_return(token);
 		case Token::KW_IF: {
 			index--;
-			std::unique_ptr<Statement> statement(new Statement(token, Statement::EXPR));
+			Statement* statement = arena->make<Statement>(token, Statement::EXPR);
 			do_expr(statement->expr, "}", true);
 			if (statement->expr.size() == 1) {
-				std::unique_ptr<If> if_statement;
-				if_statement.swap(((IfTok&)*statement->expr[0]).if_statement);
-				return std::move(if_statement);
+				return statement->expr[0].if_statement;
 			}
 			return statement;
 		}
 		case Token::KW_WHILE:  return do_while(token);
 		case Token::KW_BREAK:  return do_break(token);
 		case Token::KW_CONTINUE:
-			return std::unique_ptr<Statement>(new Statement(token, Statement::CONTINUE));
+			return arena->make<Statement>(token, Statement::CONTINUE);
 		default: return do_expr(token);
 	}
 }
 
-std::unique_ptr<Declaration> Parser::do_declare(const Token& ident) {
+Declaration* Parser::do_declare(const Token& ident) {
 	const Token& token = next();
-	std::unique_ptr<Declaration> declaration;
+	Declaration* declaration;
 	if (token.str() == "=") { // var := val
-		declaration.reset(new Declaration(ident));
+		declaration = arena->make<Declaration>(ident);
 	} else if (token.form == Token::IDENT) {  // var: type
 		assert_simple_ident(token);
 		const Token& eq_token = next();
 		if (eq_token.form == Token::END) {
-			return std::unique_ptr<Declaration>(new Declaration(ident, token));
+			return arena->make<Declaration>(ident, token);
 		}
 		if (eq_token.str() != "=") throw Except("Expected '='", eq_token);
-		declaration.reset(new Declaration(ident, token));
+		declaration = arena->make<Declaration>(ident, token);
 	} else if (token.form == Token::END) {
-		declaration.reset(new Declaration(ident));
+		declaration = arena->make<Declaration>(ident);
 		return declaration;
 	} else {
 		throw Except("Expected '=' or identifier.", token);
@@ -292,35 +292,35 @@ std::unique_ptr<Declaration> Parser::do_declare(const Token& ident) {
 	return declaration;
 }
 
-std::unique_ptr<Assignment> Parser::do_assign(const Token& ident, const Token* op_token) {
-	std::unique_ptr<Assignment> assignment(new Assignment(ident));
+Assignment* Parser::do_assign(const Token& ident, const Token* op_token) {
+	Assignment* assignment = arena->make<Assignment>(ident);
 	if (op_token != nullptr) {
 		// If it is an operator assignment (like +=) then the expression has the variable
 		// appended to the front and the operator appended to the back.
-		assignment->expr.emplace_back(new VarTok(ident));
+		assignment->expr.push_back(Tok::make_var(ident));
 		do_expr(assignment->expr, "}", true);
-		assignment->expr.emplace_back(new FuncTok(*op_token, 2));
+		assignment->expr.push_back(Tok::make_func(*op_token, 2));
 	} else {
 		do_expr(assignment->expr, "}", true);
 	}
 	return assignment;
 }
 
-std::unique_ptr<Statement> Parser::do_expr(const Token& kw) {
-	std::unique_ptr<Statement> expression(new Statement(kw, Statement::EXPR));
+Statement* Parser::do_expr(const Token& kw) {
+	Statement* expression = arena->make<Statement>(kw, Statement::EXPR);
 	index--;
 	do_expr(expression->expr, "}", true);
 	return expression;
 }
 
-std::unique_ptr<Statement> Parser::do_return(const Token& kw) {
-	std::unique_ptr<Statement> return_statement(new Statement(kw, Statement::RETURN));
+Statement* Parser::do_return(const Token& kw) {
+	Statement* return_statement = arena->make<Statement>(kw, Statement::RETURN);
 	do_expr(return_statement->expr, "}", true);
 	return return_statement;
 }
 
-std::unique_ptr<If> Parser::do_if(const Token& kw) {
-	std::unique_ptr<If> if_statement(new If(kw));
+If* Parser::do_if(const Token& kw) {
+	If* if_statement = arena->make<If>(kw);
 	do_expr(if_statement->expr, "{", false);
 	if_statement->true_block = do_block();
 	if (peek().form == Token::KW_ELSE) {
@@ -337,11 +337,11 @@ std::unique_ptr<If> Parser::do_if(const Token& kw) {
 	return if_statement;
 }
 
-std::unique_ptr<While> Parser::do_while(const Token& kw) {
-	std::unique_ptr<While> while_statement(new While(kw));
+While* Parser::do_while(const Token& kw) {
+	While* while_statement = arena->make<While>(kw);
 	if (peek().str() == "{") {
 		// of no condition, defaults to infinite loop
-		while_statement->expr.emplace_back(new ValueTok(kw, Value(true)));
+		while_statement->expr.push_back(Tok::make_value(kw, Value(true)));
 	} else {
 		do_expr(while_statement->expr, "{", false);
 	}
@@ -349,8 +349,8 @@ std::unique_ptr<While> Parser::do_while(const Token& kw) {
 	return while_statement;
 }
 
-std::unique_ptr<Break> Parser::do_break(const Token& kw) {
-	std::unique_ptr<Break> break_statement(new Break(kw));
+Break* Parser::do_break(const Token& kw) {
+	Break* break_statement = arena->make<Break>(kw);
 	const Token& token = next();
 	if (token.form != Token::END) {
 		// you can do 'return *X' to break out of X loops
@@ -390,7 +390,7 @@ void Parser::do_expr(Expr& expr, const std::string& term, bool term_on_end) {
 			// the expression has terminated
 			while (!ops.empty()) {
 				if (ops.back() == &PAREN) throw Except("Unclosed parenthesis", token);
-				expr.emplace_back(new FuncTok(*tokens.back(), ops.back()->num_params));
+				expr.push_back(Tok::make_func(*tokens.back(), ops.back()->num_params));
 				tokens.pop_back();
 				ops.pop_back();
 			}
@@ -416,15 +416,11 @@ void Parser::do_expr(Expr& expr, const std::string& term, bool term_on_end) {
 		prev_was_op = false;
 		next();
 		switch (token.form) {
-			case Token::INT:   expr.emplace_back(new ValueTok(token, Value(token.i()))); break;
-			case Token::FLOAT: expr.emplace_back(new ValueTok(token, Value(token.f()))); break;
-			case Token::KW_TRUE:  expr.emplace_back(new ValueTok(token, Value(true)));  break;
-			case Token::KW_FALSE: expr.emplace_back(new ValueTok(token, Value(false))); break;
-			case Token::KW_IF: {
-				IfTok* tok = new IfTok(token);
-				tok->if_statement = do_if(token);
-				expr.push_back(std::unique_ptr<IfTok>(tok));
-			} break;
+			case Token::INT:      expr.push_back(Tok::make_value(token, Value(token.i()))); break;
+			case Token::FLOAT:    expr.push_back(Tok::make_value(token, Value(token.f()))); break;
+			case Token::KW_TRUE:  expr.push_back(Tok::make_value(token, Value(true)));      break;
+			case Token::KW_FALSE: expr.push_back(Tok::make_value(token, Value(false)));     break;
+			case Token::KW_IF:    expr.push_back(Tok::make_if(token, do_if(token)));        break;
 			case Token::IDENT:
 				if (peek().str() == "(") {
 					// function call
@@ -441,7 +437,7 @@ void Parser::do_expr(Expr& expr, const std::string& term, bool term_on_end) {
 				} else if (peek().str() == "=") {
 					// named parameter
 				} else {
-					expr.emplace_back(new VarTok(token));
+					expr.push_back(Tok::make_var(token));
 				}
 				break;
 			case Token::SYMBOL: {
@@ -454,7 +450,7 @@ void Parser::do_expr(Expr& expr, const std::string& term, bool term_on_end) {
 						if (op == &PAREN) {
 							break;
 						} else {
-							expr.emplace_back(new FuncTok(*tokens.back(), op->num_params));
+							expr.push_back(Tok::make_func(*tokens.back(), op->num_params));
 							ops.pop_back();
 							tokens.pop_back();
 						}
@@ -475,17 +471,18 @@ void Parser::do_expr(Expr& expr, const std::string& term, bool term_on_end) {
 							if (!ops.empty() && ops.back() == &FUNC) {
 								param_ready = false;
 								ops.pop_back();
-								expr.emplace_back(new FuncTok(*tokens.back(), num_args));
+								expr.push_back(Tok::make_func(*tokens.back(), num_args));
 								if (start_named_args != -1) {
-									FuncTok& ftok = (FuncTok&) *expr.back();
-									ftok.num_unnamed_args = start_named_args;
-									ftok.named_args = named_args;
+									Tok& ftok = expr.back();
+									ftok.num_unnamed_args = (uint16_t)start_named_args;
+									ftok.call = arena->make<Call>();
+									ftok.call->named_args = named_args;
 								}
 								tokens.pop_back();
 							}
 							break;
 						} else {
-							expr.emplace_back(new FuncTok(*tokens.back(), op->num_params));
+							expr.push_back(Tok::make_func(*tokens.back(), op->num_params));
 							tokens.pop_back();
 						}
 					}
@@ -510,7 +507,7 @@ void Parser::do_expr(Expr& expr, const std::string& term, bool term_on_end) {
 					      (!op->left_assoc && op->precidence < op2->precidence))) {
 						break;
 					}
-					expr.emplace_back(new FuncTok(*tokens.back(), op2->num_params));
+					expr.push_back(Tok::make_func(*tokens.back(), op2->num_params));
 					ops.pop_back();
 					tokens.pop_back();
 				}
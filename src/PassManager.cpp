@@ -0,0 +1,85 @@
+#include "passes/PassManager.h"
+#include "ThreadPool.h"
+
+PassManager::PassManager(Stats& stats, bool fused, unsigned num_threads):
+		stats(stats), fused(fused), num_threads(num_threads) { }
+
+void PassManager::add_module_pass(const std::string& name, ModulePass pass) {
+	passes.push_back({ name, pass, nullptr, nullptr, Stats::Clock::duration::zero() });
+}
+void PassManager::add_function_pass(const std::string& name, FunctionPass pass) {
+	passes.push_back({ name, nullptr, pass, nullptr, Stats::Clock::duration::zero() });
+}
+void PassManager::add_parallel_pass(const std::string& name, ParallelPass pass) {
+	passes.push_back({ name, nullptr, nullptr, pass, Stats::Clock::duration::zero() });
+}
+
+void PassManager::run(Module& module) {
+	auto start = Stats::Clock::now();
+	for (size_t i = 0; i < passes.size();) {
+		if (passes[i].module_pass) {
+			auto pass_start = Stats::Clock::now();
+			passes[i].module_pass(module);
+			passes[i].time += Stats::Clock::now() - pass_start;
+			i++;
+			continue;
+		}
+		// unfused, every function pass gets a walk of its own
+		bool parallel = (bool)passes[i].parallel_pass;
+		size_t end = i + 1;
+		while (fused && end < passes.size() && !passes[end].module_pass &&
+		       (bool)passes[end].parallel_pass == parallel) {
+			end++;
+		}
+		if (parallel) run_parallel(module, i, end);
+		else run_fused(module, i, end);
+		i = end;
+	}
+	// reported once, so the stats lock isn't taken for every function
+	// the time of parallel passes adds up across their threads
+	for (Pass& pass : passes) {
+		stats.add_time("pass: " + pass.name, pass.time);
+		pass.time = Stats::Clock::duration::zero();
+	}
+	stats.add_time("semantic passes", Stats::Clock::now() - start);
+}
+
+void PassManager::run_fused(Module& module, size_t begin, size_t end) {
+	for (size_t i = 0; i < module.size(); i++) {
+		Item& item = module[i];
+		if (item.form != Item::FUNCTION) continue;
+		Function& func = (Function&)item;
+		auto time = Stats::Clock::now();
+		for (size_t j = begin; j < end; j++) {
+			passes[j].function_pass(module, func);
+			auto now = Stats::Clock::now();
+			passes[j].time += now - time;
+			time = now;
+		}
+	}
+}
+
+void PassManager::run_parallel(Module& module, size_t begin, size_t end) {
+	std::vector<Function*> funcs;
+	for (size_t i = 0; i < module.size(); i++) {
+		if (module[i].form == Item::FUNCTION) funcs.push_back((Function*)&module[i]);
+	}
+	size_t num_passes = end - begin;
+	std::vector<Stats::Clock::duration> times(num_threads * num_passes);
+	WorkQueue queue(funcs.size());
+	::run_parallel(num_threads, [&](unsigned thread) {
+		size_t index;
+		while (queue.next(index)) {
+			auto time = Stats::Clock::now();
+			for (size_t j = begin; j < end; j++) {
+				passes[j].parallel_pass(module, *funcs[index], thread);
+				auto now = Stats::Clock::now();
+				times[thread * num_passes + j - begin] += now - time;
+				time = now;
+			}
+		}
+	});
+	for (size_t i = 0; i < times.size(); i++) {
+		passes[begin + i % num_passes].time += times[i];
+	}
+}
@@ -0,0 +1,57 @@
+#include "passes/PurityChecker.h"
+#include <algorithm>
+
+// every function starts out as pure as can be and only gets less so as what it calls does,
+// until nothing changes, so functions calling each other in a cycle can still be pure
+void PurityChecker::check(Module& module) {
+	std::vector<Function*> funcs;
+	for (size_t i = 0; i < module.size(); i++) {
+		Item& item = module[i];
+		if (item.form != Item::FUNCTION || ((Function&)item).form != Function::USER) continue;
+		funcs.push_back((Function*)&item);
+		funcs.back()->purity = Function::READ_NONE;
+	}
+	for (bool changed = true; changed;) {
+		changed = false;
+		for (Function* func : funcs) {
+			Function::Purity purity = check(func->block);
+			if (purity != func->purity) {
+				func->purity = purity;
+				changed = true;
+			}
+		}
+	}
+	for (Function* func : funcs) {
+		if (func->purity != Function::WRITES) num_pure++;
+	}
+}
+
+Function::Purity PurityChecker::check(const Block& block) {
+	Function::Purity purity = Function::READ_NONE;
+	for (Statement* statement : block) {
+		if (statement->form == Statement::ASSIGNMENT && ((Assignment*)statement)->var.global) {
+			return Function::WRITES;
+		}
+		purity = std::max(purity, check(statement->expr));
+		for (Block* inner_block : statement->blocks()) {
+			purity = std::max(purity, check(*inner_block));
+		}
+		if (purity == Function::WRITES) break;
+	}
+	return purity;
+}
+
+Function::Purity PurityChecker::check(const Expr& expr) {
+	Function::Purity purity = Function::READ_NONE;
+	for (size_t i = 0; i < expr.size(); i++) {
+		const Tok& tok = expr[i];
+		if (tok.form == Tok::VAR && tok.var.global != nullptr) {
+			purity = std::max(purity, Function::READ_ONLY);
+		} else if (tok.form == Tok::FUNC && tok.call != nullptr && tok.call->func != nullptr) {
+			// operators, casts & constructors are built inline and never touch memory
+			const Function& func = *tok.call->func;
+			if (func.form == Function::USER) purity = std::max(purity, func.purity);
+		}
+	}
+	return purity;
+}
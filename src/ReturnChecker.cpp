@@ -6,19 +6,23 @@ void ReturnChecker::check(Module& module) {
 		Item& item = module[i];
 		switch (item.form) {
 			case Item::FUNCTION: {
-				Function& func = (Function&)item;
-				create_drops(&func.block);
-				if (func.return_type != Type::Void) {
-					if (!check(func.block)) {
-						create_implicit_returns(func.block);
-					}
-				}
+				check(module, (Function&)item);
 			} break;
 			default: break;
 		}
 	}
 }
 
+void ReturnChecker::check(Module& module, Function& func) {
+	arena = &module.arena();
+	create_drops(&func.block);
+	if (func.return_type != Type::Void) {
+		if (!check(func.block)) {
+			create_implicit_returns(func.block);
+		}
+	}
+}
+
 bool ReturnChecker::check(Block& block) {
 	for (size_t i = 0; i < block.size(); i++) {
 		Statement& statement = *block[i];
@@ -50,9 +54,9 @@ void ReturnChecker::create_implicit_returns(Block& block) {
 	Statement& statement = *block.back();
 	switch (statement.form) {
 		case Statement::EXPR: {
-			std::unique_ptr<Statement> ret(new Statement(statement.token, Statement::RETURN));
+			Statement* ret = arena->make<Statement>(statement.token, Statement::RETURN);
 			ret->expr.swap(statement.expr);
-			block.back().swap(ret);
+			block.back() = ret;
 		} break;
 		case Statement::IF: {
 			If& if_statement = (If&) statement;
@@ -70,12 +74,9 @@ void ReturnChecker::create_drops(Block* block) {
 		if (!statement.expr.empty()) {
 			std::vector<Statement*> new_statements;
 			create_drops(statement.expr, new_statements);
-			for (Statement* new_statement : new_statements) {
-				new_block.push_back(std::unique_ptr<Statement>(new_statement));
-			}
+			new_block.insert(new_block.end(), new_statements.begin(), new_statements.end());
 		}
-		new_block.emplace_back();
-		new_block.back().swap(block->at(i));
+		new_block.push_back(block->at(i));
 	}
 	*block = std::move(new_block);
 	for (size_t i = 0; i < block->size(); i++) {
@@ -87,20 +88,20 @@ void ReturnChecker::create_drops(Block* block) {
 
 void ReturnChecker::create_drops(Expr& expr, std::vector<Statement*>& new_statements) {
 	for (size_t i = 0; i < expr.size(); i++) {
-		Tok& tok = *expr[i];
+		Tok& tok = expr[i];
 		switch (tok.form) {
 			case Tok::IF: {
-				If& if_statement = *((IfTok&)tok).if_statement;
+				If& if_statement = *tok.if_statement;
 				std::stringstream ss;
 				ss << "eb$tmp" << index++;
-				Token* t = new Token(Token::IDENT, ss.str(), tok.token->line, tok.token->column);
-				phantom_tokens.emplace_back(std::unique_ptr<Token>(t));
-				Declaration* decl = new Declaration(*t);
+				Token* t = arena->make<Token>(Token::IDENT, ss.str(), tok.token->line,
+				                              tok.token->column);
+				Declaration* decl = arena->make<Declaration>(*t);
 				new_statements.push_back(decl);
 				new_statements.push_back(&if_statement);
 				create_drop(if_statement.true_block, if_statement.token, *t);
 				create_drop(if_statement.else_block, if_statement.token, *t);
-				expr[i].reset(new VarTok(*t));
+				expr[i] = Tok::make_var(*t);
 			} break;
 			default: break;
 		}
@@ -112,9 +113,9 @@ void ReturnChecker::create_drop(Block& block, const Token& token, Token& tmp) {
 	Statement& statement = *block.back();
 	switch (statement.form) {
 		case Statement::EXPR: {
-			std::unique_ptr<Statement> assign(new Assignment(tmp));
+			Statement* assign = arena->make<Assignment>(tmp);
 			assign->expr.swap(statement.expr);
-			block.back().swap(assign);
+			block.back() = assign;
 		} break;
 		case Statement::IF: {
 			If& if_statement = (If&)statement;
@@ -1,78 +1,45 @@
-#include <iostream>
 #include "State.h"
 
-Scope& Scope::to_subscope(Block& block) {
-	auto iter = children_map.find(&block);
-	if (iter == children_map.end()) {
-		children.emplace_back(new Scope());
-		children.back()->parent = this;
-		children_map[&block] = children.back().get();
-		return *children.back();
-	}
-	Scope& subscope = *iter->second;
-	return *iter->second;
-}
-
-Scope* Scope::get_parent() {
-	return parent;
-}
-
-Loop* Scope::get_loop(int amount) {
-	if (loop == nullptr) {
-		if (parent == nullptr) return nullptr;
-		return parent->get_loop(amount);
-	} else if (amount > 1) {
-		if (parent == nullptr) return nullptr;
-		return parent->get_loop(amount - 1);
-	}
-	return loop.get();
-}
-void Scope::create_loop() {
-	loop.reset(new Loop());
-}
-
-Variable* Scope::declare(std::string name, Type type) {
-	if (variables.count(name)) return nullptr;
-	variables[name] = Variable(type);
-	return &variables[name];
-}
-
-
-Variable* Scope::get(const std::string& name) {
-	auto iter = variables.find(name);
-	if (iter == variables.end()) {
-		if (parent == nullptr) return nullptr;
-		return parent->get(name);
-	}
-	return &iter->second;
-}
-
-State::State(Module& module): module(&module) {
-	current_scope = &root_scope;
-}
+State::State(Module& module): module(&module) { }
 
 Module& State::get_module() {
 	return *module;
 }
 
-void State::descend(Block& block) {
-	current_scope = &current_scope->to_subscope(block);
+void State::descend() {
+	scope_starts.push_back(shadowed.size());
 }
 void State::ascend() {
-	current_scope = current_scope->get_parent();
+	assert(!scope_starts.empty());
+	// newest first, so a name declared twice ends up with its oldest binding
+	for (size_t i = shadowed.size(); i > scope_starts.back(); i--) {
+		Shadowed& old = shadowed[i - 1];
+		bindings[old.name] = old.binding;
+	}
+	shadowed.resize(scope_starts.back());
+	scope_starts.pop_back();
 }
 
-Variable* State::declare(std::string name, Type type) {
-	return current_scope->declare(name, type);
-}
-Variable* State::get_var(const std::string& name) const {
-	auto var = current_scope->get(name);
-	if (var == nullptr) {
+int State::declare(uint32_t name, Type type) {
+	assert(current_func && !scope_starts.empty());
+	Binding& binding = bindings[name];
+	if (binding.slot != -1 && binding.depth == scope_starts.size()) return -1;
+	shadowed.push_back({ name, binding });
+	binding.slot = (int)current_func->locals.size();
+	binding.depth = scope_starts.size();
+	current_func->locals.emplace_back(type);
+	return binding.slot;
+}
+VarRef State::lookup(uint32_t name) const {
+	VarRef ref;
+	const Binding* binding = bindings.find(name);
+	if (binding != nullptr && binding->slot != -1) {
+		ref.slot = binding->slot;
+	} else {
 		Global* global = module->get_global(name);
-		if (global == nullptr) return nullptr;
-		return &global->var;
+		if (global != nullptr) ref.global = &global->var;
 	}
-	return var;
+	return ref;
 }
 
 void State::set_func(Function& func) {
@@ -83,9 +50,15 @@ Function& State::get_func() const {
 	return *current_func;
 }
 
-Loop* State::get_loop(int amount) const {
-	return current_scope->get_loop(amount);
+Loop* State::get_loop(int amount) {
+	if (amount < 1) amount = 1;
+	if ((size_t)amount > loops.size()) return nullptr;
+	return &loops[loops.size() - amount];
+}
+Loop& State::push_loop() {
+	loops.emplace_back();
+	return loops.back();
 }
-void State::create_loop() {
-	return current_scope->create_loop();
+void State::pop_loop() {
+	loops.pop_back();
 }
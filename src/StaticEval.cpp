@@ -6,22 +6,21 @@
 Value StaticEval::eval(Type& target, Expr& expr) {
 	std::vector<Value> stack;
 	for (size_t i = 0; i < expr.size(); i++) {
-		Tok& tok = *expr[i];
+		const Tok& tok = expr[i];
 		switch (tok.form) {
-			case Tok::VALUE: stack.push_back(((ValueTok&)tok).value); break;
+			case Tok::VALUE: stack.push_back(tok.value); break;
 			case Tok::FUNC: {
-				FuncTok& ftok = (FuncTok&)tok;
-				if (!ftok.token->form == Token::SYMBOL) {
+				if (!tok.token->form == Token::SYMBOL) {
 					throw ("Can't yet evaluate functions in constant expr", *tok.token);
 				}
-				if (ftok.num_args == 1) {
-					Value res = eval(ftok.token->str(), stack.back(), *tok.token);
+				if (tok.num_args == 1) {
+					Value res = eval(tok.token->str(), stack.back(), *tok.token);
 					stack.pop_back();
 					stack.push_back(res);
 				} else {
 					Value a = stack[stack.size() - 2];
 					Value b = stack.back();
-					Value res = eval(tok.token->str(), a, b, *ftok.token);
+					Value res = eval(tok.token->str(), a, b, *tok.token);
 					stack.pop_back(); stack.pop_back();
 					stack.push_back(res);
 				}
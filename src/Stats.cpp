@@ -0,0 +1,54 @@
+#include "Stats.h"
+#include <iomanip>
+
+void Stats::add_time(const std::string& name, Clock::duration time) {
+	std::lock_guard<std::mutex> lock(mutex);
+	Entry& entry = get(name);
+	entry.time += time;
+	entry.timed = true;
+}
+void Stats::add_count(const std::string& name, uint64_t count) {
+	std::lock_guard<std::mutex> lock(mutex);
+	get(name).count += count;
+}
+
+void Stats::add_ratio(const std::string& name, uint64_t count, uint64_t total) {
+	std::lock_guard<std::mutex> lock(mutex);
+	Entry& entry = get(name);
+	entry.count += count;
+	entry.total += total;
+	entry.ratio = true;
+}
+
+void Stats::print(std::ostream& out) const {
+	std::lock_guard<std::mutex> lock(mutex);
+	for (auto& entry : entries) {
+		out << std::left << std::setw(32) << entry.name;
+		if (entry.timed) {
+			double ms = std::chrono::duration<double, std::milli>(entry.time).count();
+			out << std::right << std::fixed << std::setprecision(3) << std::setw(12) << ms << " ms";
+		} else if (entry.ratio) {
+			double percent = entry.total == 0 ? 0 : 100.0 * entry.count / entry.total;
+			out << std::right << std::setw(12) << entry.count << " / " << entry.total << " ("
+			    << std::fixed << std::setprecision(1) << percent << "%)";
+		} else {
+			out << std::right << std::setw(12) << entry.count;
+		}
+		out << std::endl;
+	}
+}
+
+Stats::Entry& Stats::get(const std::string& name) {
+	for (auto& entry : entries) {
+		if (entry.name == name) return entry;
+	}
+	entries.emplace_back();
+	entries.back().name = name;
+	return entries.back();
+}
+
+Timer::Timer(Stats& stats, std::string name):
+		stats(stats), name(name), start(Stats::Clock::now()) { }
+Timer::~Timer() {
+	stats.add_time(name, Stats::Clock::now() - start);
+}
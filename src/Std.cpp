@@ -1,6 +1,6 @@
 #include "Std.h"
 
-Std::Std() {
+Std::Std(int pointer_size) : pointer_size(pointer_size) {
 	add_signed(Type::IntLit);
 	add_signed(Type::Int);
 	add_signed(Type::I8);
@@ -24,6 +24,13 @@ Std::Std() {
 	add_func("!", {Type::Bool}, Type::Bool);
 	add_func("&&", {Type::Bool, Type::Bool}, Type::Bool);
 	add_func("||",  {Type::Bool, Type::Bool}, Type::Bool);
+
+	add_casts();
+}
+
+int Std::size(Type type) const {
+	if (type == Type::Int || type == Type::IPtr || type == Type::UPtr) return pointer_size;
+	return type.size();
 }
 
 void Std::add_signed(Type type) {
@@ -76,39 +83,44 @@ void Std::add_eq(Type type) {
 }
 
 void Std::add_func(std::string name, std::vector<Type> params, Type ret) {
-	Token* token = new Token(Token::IDENT, name);
-	tokens.push_back(std::unique_ptr<Token>(token));
-	Function* func = new Function(*token);
+	Token* token = arena.make<Token>(Token::IDENT, name);
+	Function* func = arena.make<Function>(*token);
 	func->param_names.resize(params.size());
 	func->param_types = params;
 	func->return_type = ret;
 	func->form = Function::OP;
-	operators.push_back(std::unique_ptr<Function>(func));
+	auto& overloads = operators[(uint64_t)token->symbol() << 32 | params.size()];
+	func->index = (int)overloads.size();
+	overloads.push_back(func);
 }
 
-void Std::add_operators(Module& module) {
-	for (size_t i = 0; i < operators.size(); i++) {
-		module.declare(*operators[i]);
+const std::vector<Function*>& Std::get_operators(int num_params, uint32_t name) const {
+	auto iter = operators.find((uint64_t)name << 32 | (uint32_t)num_params);
+	if (iter == operators.end()) {
+		static const std::vector<Function*> empty;
+		return empty;
 	}
+	return iter->second;
 }
 
-Function* Std::get_cast(Type from, Type to) {
-	auto iter = casts.find(std::make_pair(from, to));
-	if (iter == casts.end()) {
-		// assert is valid implicit primitive cast
-		if (to == Type::IntLit) return nullptr;
-		if (!((from == Type::IntLit && to.is_number()) || (from.is_int() && to.is_int()))) {
-			return nullptr;
+void Std::add_casts() {
+	for (size_t i = 0; i < NUM_FORMS; i++) {
+		for (size_t j = 0; j < NUM_FORMS; j++) {
+			Type from = (Type::Form)i;
+			Type to = (Type::Form)j;
+			// only valid implicit primitive casts
+			if (to == Type::IntLit) continue;
+			if (!((from == Type::IntLit && to.is_number()) || (from.is_int() && to.is_int()))) {
+				continue;
+			}
+			Token* token = arena.make<Token>(Token::IDENT,
+			                                 from.to_string() + "->" + to.to_string());
+			Function* func = arena.make<Function>(*token);
+			func->param_names.resize(1);
+			func->param_types.push_back(from);
+			func->return_type = to;
+			func->form = Function::CAST;
+			casts[i][j] = func;
 		}
-		Token* token = new Token(Token::IDENT, from.to_string() + "->" + to.to_string());
-		tokens.push_back(std::unique_ptr<Token>(token));
-		Function* func = new Function(*token);
-		func->param_names.resize(1);
-		func->param_types.push_back(from);
-		func->return_type = to;
-		func->form = Function::CAST;
-		casts[std::make_pair(from, to)] = std::unique_ptr<Function>(func);
-		return func;
 	}
-	return &*iter->second;
 }
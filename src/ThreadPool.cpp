@@ -0,0 +1,86 @@
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool(unsigned num_threads) {
+	if (num_threads == 0) num_threads = std::thread::hardware_concurrency();
+	if (num_threads == 0) num_threads = 1;
+	for (unsigned i = 0; i < num_threads; i++) {
+		threads.emplace_back(&ThreadPool::work, this);
+	}
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	task_ready.notify_all();
+	for (auto& thread : threads) {
+		thread.join();
+	}
+}
+
+void ThreadPool::submit(std::function<void()> task) {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		tasks.push_back(std::move(task));
+	}
+	task_ready.notify_one();
+}
+
+void ThreadPool::wait() {
+	std::unique_lock<std::mutex> lock(mutex);
+	all_done.wait(lock, [this]() { return tasks.empty() && active == 0; });
+	if (error) {
+		std::exception_ptr to_throw = error;
+		error = nullptr;
+		std::rethrow_exception(to_throw);
+	}
+}
+
+size_t ThreadPool::size() const {
+	return threads.size();
+}
+
+void ThreadPool::work() {
+	std::unique_lock<std::mutex> lock(mutex);
+	while (true) {
+		task_ready.wait(lock, [this]() { return stopping || !tasks.empty(); });
+		if (tasks.empty()) return;
+		std::function<void()> task = std::move(tasks.front());
+		tasks.pop_front();
+		active++;
+		lock.unlock();
+		try {
+			task();
+		} catch (...) {
+			lock.lock();
+			if (!error) error = std::current_exception();
+			lock.unlock();
+		}
+		lock.lock();
+		active--;
+		if (tasks.empty() && active == 0) all_done.notify_all();
+	}
+}
+
+void run_parallel(unsigned num_threads, const std::function<void(unsigned thread)>& work) {
+	std::vector<std::exception_ptr> errors(num_threads);
+	auto run = [&](unsigned thread) {
+		try {
+			work(thread);
+		} catch (...) {
+			errors[thread] = std::current_exception();
+		}
+	};
+	std::vector<std::thread> threads;
+	for (unsigned i = 1; i < num_threads; i++) {
+		threads.emplace_back(run, i);
+	}
+	run(0);
+	for (auto& thread : threads) {
+		thread.join();
+	}
+	for (auto& error : errors) {
+		if (error) std::rethrow_exception(error);
+	}
+}
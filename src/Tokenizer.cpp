@@ -1,19 +1,48 @@
 #include "Tokenizer.h"
 #include "Util.h"
 #include <algorithm>
+#include <limits>
 
-Tokenizer::Tokenizer(const std::string& str): str(str) {
-	do_whitespace();
-	this->str.clear();
+// every byte falls into one class, the lexer dispatches on it instead of calling isalpha & co.
+enum CharClass : uint8_t {
+	C_END, C_NEWLINE, C_SPACE, C_WORD, C_DIGIT, C_DOT, C_SLASH, C_SEMICOLON, C_HASH, C_SYMBOL
+};
+struct CharTable {
+	CharClass classes[256];
+	CharTable() {
+		for (int i = 0; i < 256; i++) {
+			char c = (char)i;
+			if      (c == 0)                        classes[i] = C_END;
+			else if (c == '\n')                     classes[i] = C_NEWLINE;
+			else if (!isascii(c))                   classes[i] = C_WORD;
+			else if (isspace(c))                    classes[i] = C_SPACE;
+			else if (isdigit(c))                    classes[i] = C_DIGIT;
+			else if (is_valid_ident_beginning(c))   classes[i] = C_WORD;
+			else if (c == '.')                      classes[i] = C_DOT;
+			else if (c == '/')                      classes[i] = C_SLASH;
+			else if (c == ';')                      classes[i] = C_SEMICOLON;
+			else if (c == '#')                      classes[i] = C_HASH;
+			else                                    classes[i] = C_SYMBOL;
+		}
+	}
+	inline CharClass operator[](char c) const {
+		return classes[(unsigned char)c];
+	}
+};
+static const CharTable CHARS;
+
+static uint32_t intern(const char* str) {
+	return Interner::get().intern(str, strlen(str));
 }
 
-Tokenizer::Tokenizer(std::ifstream& file) {
-	std::stringstream buffer;
-	buffer << file.rdbuf();
-	str = std::move(buffer.str());
-	do_whitespace();
-	str.clear();
-	file.close();
+Tokenizer::Tokenizer(const std::string& str): Tokenizer(str.data(), str.size()) { }
+
+Tokenizer::Tokenizer(const MappedFile& file): Tokenizer(file.data(), file.size()) { }
+
+Tokenizer::Tokenizer(const char* data, size_t size): src(data), length(size) {
+	tokenize();
+	src = nullptr;
+	length = 0;
 }
 
 const std::vector<Token>& Tokenizer::get_tokens() const {
@@ -23,153 +52,174 @@ const std::vector<std::pair<Trait, std::string>>& Tokenizer::get_traits() const
 	return traits;
 }
 
-// toss that worthless whitespace
-void Tokenizer::do_whitespace() {
+// one token per iteration, nothing recurses so the stack stays flat however long the file is
+void Tokenizer::tokenize() {
+	// a '.' right after whitespace always starts a number, elsewhere it can be a symbol
+	bool after_space = true;
+	static const uint32_t newline = intern("\n");
+	static const uint32_t semicolon = intern(";");
 	while (true) {
-		char c = str[index];
-		if (c == '\n') {
-			tokens.push_back(Token(Token::END, "\n", line, column));
-			line++;
-			column = 0;
-		} else if (is_valid_ident_beginning(c)) {
-			return do_word();
-		} else if (isdigit(c) || c == '.') {
-			return do_number();
-		} else if (!isspace(c)) {
-			return do_symbol();
+		char c = at(index);
+		switch (CHARS[c]) {
+			case C_END: return;
+			case C_NEWLINE:
+				tokens.push_back(Token(Token::END, newline, line, column));
+				line++;
+				column = 1;
+				index++;
+				after_space = true;
+				continue;
+			case C_SPACE:
+				index++;
+				column++;
+				after_space = true;
+				continue;
+			case C_WORD:
+				do_word();
+				break;
+			case C_DIGIT:
+				do_number();
+				break;
+			case C_DOT:
+				if (after_space) {
+					do_number();
+				} else if (!tokens.empty() && tokens.back().form == Token::IDENT) {
+					// member access, joined onto the identifier before it
+					char d = at(++index);
+					if (CHARS[d] == C_WORD) {
+						connecting = true;
+						do_word();
+					} else {
+						add_symbol(".", 1);
+					}
+				} else if (CHARS[at(index + 1)] == C_DIGIT) {
+					do_number();
+				} else {
+					column++;
+					add_symbol(".", 1);
+					index++;
+				}
+				break;
+			case C_SLASH:
+				// Comments!
+				column++;
+				switch (at(++index)) {
+					case 0:
+						add_symbol("/", 1);
+						return;
+					case '*':
+						column += 2;
+						while (true) {
+							if (!at(++index)) return; // unterminated comment
+							if (at(index) == '*' && at(index + 1) == '/') {
+								index += 2;
+								break;
+							}
+						}
+						break;
+					case '/':
+						column = 1;
+						while (true) {
+							if (!at(index++)) return;
+							if (at(index) == '\n') break;
+						}
+						break;
+					default: add_symbol("/", 1); break;
+				}
+				break;
+			case C_SEMICOLON:
+				tokens.push_back(Token(Token::END, semicolon, line, column));
+				column++;
+				index++;
+				break;
+			case C_HASH:
+				do_trait();
+				after_space = true;
+				continue;
+			case C_SYMBOL: {
+				char d = at(index + 1);
+				if (((c == '!' || c == '>' || c == '<' || c == '=') && d == '=') ||
+				    ((c == '&' || c == '|' || c == '<' || c == '>') && d == c)) {
+					add_symbol(src + index, 2);
+					column += 2;
+					index += 2;
+				} else {
+					column++;
+					add_symbol(src + index++, 1);
+				}
+			} break;
 		}
-		index++;
-		column++;
+		after_space = false;
 	}
 }
 
-
 // identifiers
 // start with _ or letter, continue as _'s, letters's and number's (non-ascii also allowed)
 void Tokenizer::do_word() {
-	std::string word;
-	word += str[index];
-	while (true) {
+	size_t start = index;
+	do {
 		column++;
-		char c = str[++index];
-		if (is_valid_ident(c)) {
-			word += c;
-		} else {
-			auto iter = KEYWORDS.find(word);
-			if (iter != KEYWORDS.end()) {
-				tokens.push_back(Token(iter->second, word, line, column));
-			} else if (connecting) {
-				tokens.back().add_str(word);
-				connecting = false;
-			} else {
-				tokens.push_back(Token(Token::IDENT, word, line, column));
-			}
-			if (isspace(c)) {
-				return do_whitespace();
-			} else {
-				return do_symbol();
-			}
-		}
+		index++;
+	} while (CHARS[at(index)] == C_WORD || CHARS[at(index)] == C_DIGIT);
+	// the slice of the source is only copied the first time it is seen
+	uint32_t id = Interner::get().intern(src + start, index - start);
+
+	static const std::unordered_map<uint32_t, Token::Form> keywords = {
+			{intern("true"), Token::KW_TRUE}, {intern("false"), Token::KW_FALSE},
+			{intern("pub"), Token::KW_PUB}, {intern("fn"), Token::KW_FN},
+			{intern("return"), Token::KW_RETURN}, {intern("if"), Token::KW_IF},
+			{intern("else"), Token::KW_ELSE}, {intern("while"), Token::KW_WHILE},
+			{intern("continue"), Token::KW_CONTINUE}, {intern("break"), Token::KW_BREAK}
+	};
+	auto iter = keywords.find(id);
+	if (iter != keywords.end()) {
+		tokens.push_back(Token(iter->second, id, line, column));
+	} else if (connecting) {
+		tokens.back().add_str(id);
+		connecting = false;
+	} else {
+		tokens.push_back(Token(Token::IDENT, id, line, column));
 	}
 }
 
 void Tokenizer::do_number() {
-	std::string number;
-	number += str[index];
+	size_t start = index;
 	bool prev_e = false;
 	while (true) {
 		column++;
-		char c = str[++index];
-		if (isdigit(c) || isalpha(c) || c == '_' || c == '.' || (prev_e && c == '-')) {
+		char c = at(++index);
+		CharClass char_class = CHARS[c];
+		if (char_class == C_DIGIT || char_class == C_DOT || (char_class == C_WORD && isascii(c)) ||
+		    (prev_e && c == '-')) {
 			prev_e = (c == 'e' || c == 'E');
-			number += c;
 		} else {
-			tokens.push_back(Token(Token::FLOAT, number, line, column));
-			parse_num(tokens.back());
-			if (isspace(c)) {
- 				return do_whitespace();
-			} else {
-				return do_symbol();
-			}
+			break;
 		}
 	}
+	uint32_t id = Interner::get().intern(src + start, index - start);
+	tokens.push_back(Token(Token::FLOAT, id, line, column));
+	parse_num(tokens.back());
 }
 
-void Tokenizer::do_symbol() {
-	char c = str[index];
-	if (!c) return;
-	if (c == '/') {
-		// Comments!
-		column++;
-		switch (str[++index]) {
-			case 0: return add_symbol("/");
-			case '*':
-				column += 2;
-				while (true) {
-					if (!str[++index]) return; // unterminated comment
-					if (str[index] == '*' && str[index + 1] == '/') {
-						index += 2;
-						return do_symbol();
-					}
-				}
-			case '/':
-			column = 1;
-				while (true) {
-					if (!str[index++]) return;
-					if (str[index] == '\n') return do_symbol();
-				}
-			default: add_symbol("/"); break;
-		}
-	} else if (isspace(c)) {
-		return do_whitespace();
-	} else if (is_valid_ident_beginning(c)) {
-		return do_word();
-	} else if (c == '.' && tokens.back().form == Token::IDENT) {
-		char d = str[++index];
-		if (is_valid_ident_beginning(d)) {
-			connecting = true;
-			do_word();
-		} else {
-			add_symbol(str.substr(index - 1, 1));
-		}
-	} else if (isdigit(c) || (c == '.' && isdigit(str[index + 1]))) {
-		return do_number();
-	} else if (c == ';') {
-		tokens.push_back(Token(Token::END, ";", line, column));
-		column++;
-		index++;
-	} else if (c == '#') {
-		column++;
-		index++;
-		size_t j;
-		for (j = 0; !isspace(str[index + j]); j++);
-		std::string key = str.substr(index, j);
-		auto iter = TRAITS.find(key);
-		if (iter == TRAITS.end()) {
-			throw Except("'" + key + "' is not a valid trait", BLANK_TOKEN);
-		}
-		for (index += j; isspace(str[index]); index++);
-		for (j = 0; !isspace(str[index + j]); j++);
-		traits.push_back(std::make_pair(iter->second, str.substr(index, j)));
-		index += j;
-		return do_whitespace();
-	} else if ((c == '!' || c == '>' || c == '<' || c == '=') && str[index + 1] == '=') {
-		add_symbol(str.substr(index, 2));
-		column += 2;
-		index += 2;
-	} else if ((c == '&' || c == '|' || c == '<' || c == '>') && str[index + 1] == c) {
-		add_symbol(str.substr(index, 2));
-		column += 2;
-		index += 2;
-	} else {
-		column++;
-		add_symbol(str.substr(index++, 1));
+// #trait value
+void Tokenizer::do_trait() {
+	column++;
+	index++;
+	size_t j;
+	for (j = 0; at(index + j) && !isspace(at(index + j)); j++);
+	std::string key(src + index, j);
+	auto iter = TRAITS.find(key);
+	if (iter == TRAITS.end()) {
+		throw Except("'" + key + "' is not a valid trait", BLANK_TOKEN);
 	}
-	do_symbol();
+	for (index += j; isspace(at(index)); index++);
+	for (j = 0; at(index + j) && !isspace(at(index + j)); j++);
+	traits.push_back(std::make_pair(iter->second, std::string(src + index, j)));
+	index += j;
 }
 
-void Tokenizer::add_symbol(std::string s) {
-	tokens.push_back(Token(Token::SYMBOL, s, line, column));
+void Tokenizer::add_symbol(const char* data, size_t len) {
+	tokens.push_back(Token(Token::SYMBOL, Interner::get().intern(data, len), line, column));
 }
 
 
@@ -178,8 +228,8 @@ void Tokenizer::parse_num(Token& token) {
 		token.form = Token::SYMBOL;
 		return;
 	}
-	std::string str;
-	std::transform(token.str().begin(), token.str().end(), str.begin(), ::tolower);
+	std::string str(token.str());
+	std::transform(str.begin(), str.end(), str.begin(), ::tolower);
 	if (token.str().size() >= 2 && token.str()[1] == 'x') {
 		parse_int(token, str);
 	} else if (token.str().find('e') != std::string::npos ||
@@ -20,14 +20,14 @@ Type::Type(Token::Suffix suffix) {
 int Type::size() const {
 	switch (form) {
 		case IntLit:                  return sizeof(uintmax_t);
-		case Int:                     return sizeof(int_fast32_t);
 		case U8:  case I8: case Bool: return 1;
 		case U16: case I16:           return 2;
 		case U32: case I32: case F32: return 4;
 		case U64: case I64: case F64: return 8;
-		case UPtr: case IPtr:         return sizeof(uintptr_t);
 		case Float:                   return sizeof(long double);
-		default: assert(false); break;
+		// as wide as the target's pointers, which only Std::size knows
+		case Int: case UPtr: case IPtr: return 0;
+		default: assert(false); return 0;
 	}
 }
 
@@ -1,6 +1,14 @@
 #include <Tokenizer.h>
 #include "Parser.h"
+#include "Std.h"
+#include "State.h"
+#include "passes/PassManager.h"
+#include "passes/TypeChecker.h"
+#include "passes/PurityChecker.h"
 #include "catch.hpp"
+#include <chrono>
+#include <sstream>
+#include <atomic>
 
 TEST_CASE("function", "[constructor]") {
 	std::cout << "Construct function..." << std::endl;
@@ -36,9 +44,9 @@ TEST_CASE("assignment", "[constructor]") {
 	REQUIRE(assignment2.token == Token(Token::IDENT, "x"));
 	Expr& expr = assignment2.expr;
 	REQUIRE(expr.size() == 5);
-	REQUIRE(expr[0]->form == Tok::VAR);
-	REQUIRE(expr[0]->token == &assignment2.token);
-	REQUIRE(expr.back()->form == Tok::FUNC);
+	REQUIRE(expr[0].form == Tok::VAR);
+	REQUIRE(expr[0].token == &assignment2.token);
+	REQUIRE(expr.back().form == Tok::FUNC);
 }
 
 TEST_CASE("declaration", "[constructor]") {
@@ -75,24 +83,24 @@ TEST_CASE("expression", "[constructor]") {
 
 	Expr& expr1 = block[0]->expr;
 	REQUIRE(expr1.size() == 10);
-	REQUIRE(((ValueTok&)*expr1[0]).value.i() == 5);
-	REQUIRE(((ValueTok&)*expr1[1]).value.i() == 4);
-	REQUIRE(((ValueTok&)*expr1[2]).value.i() == 3);
-	REQUIRE(expr1[3]->token->str() == "-");
-	REQUIRE(((ValueTok&)*expr1[4]).value.i() == 2);
-	REQUIRE(expr1[5]->token->str() == "+");
-	REQUIRE(expr1[6]->token->str() == "*");
-	REQUIRE(((ValueTok&)*expr1[7]).value.i() == 1);
-	REQUIRE(expr1[8]->token->str() == "/");
-	REQUIRE(expr1[9]->token->str() == "-");
+	REQUIRE(expr1[0].value.i() == 5);
+	REQUIRE(expr1[1].value.i() == 4);
+	REQUIRE(expr1[2].value.i() == 3);
+	REQUIRE(expr1[3].token->str() == "-");
+	REQUIRE(expr1[4].value.i() == 2);
+	REQUIRE(expr1[5].token->str() == "+");
+	REQUIRE(expr1[6].token->str() == "*");
+	REQUIRE(expr1[7].value.i() == 1);
+	REQUIRE(expr1[8].token->str() == "/");
+	REQUIRE(expr1[9].token->str() == "-");
 
 	Expr& expr2 = block[1]->expr;
 	REQUIRE(expr2.size() == 5);
-	REQUIRE(((ValueTok&)*expr2[0]).value.b());
-	REQUIRE(((ValueTok&)*expr2[1]).value.i() == 3);
-	REQUIRE(((ValueTok&)*expr2[2]).value.i() == 4);
-	REQUIRE(expr2[3]->token->str() == "<=");
-	REQUIRE(expr2[4]->token->str() == "&&");
+	REQUIRE(expr2[0].value.b());
+	REQUIRE(expr2[1].value.i() == 3);
+	REQUIRE(expr2[2].value.i() == 4);
+	REQUIRE(expr2[3].token->str() == "<=");
+	REQUIRE(expr2[4].token->str() == "&&");
 }
 
 TEST_CASE("function call", "[constructor]") {
@@ -105,20 +113,22 @@ TEST_CASE("function call", "[constructor]") {
 	Block& block = ((Function&)mod[0]).block;
 
 	Expr& expr1 = block[0]->expr;
-	REQUIRE(expr1[4]->token->str() == "foo");
-	REQUIRE(dynamic_cast<FuncTok&>(*expr1[4]).num_args == 2);
+	REQUIRE(expr1[4].token->str() == "foo");
+	REQUIRE(expr1[4].num_args == 2);
 
 	Expr& expr2 = block[1]->expr;
-	REQUIRE(dynamic_cast<FuncTok&>(*expr2[0]).num_args == 0);
+	REQUIRE(expr2[0].num_args == 0);
 
 	Expr& expr3 = block[2]->expr;
-	ValueTok& vtok = dynamic_cast<ValueTok&>(*expr3[2]);
+	Tok& vtok = expr3[2];
+	REQUIRE(vtok.form == Tok::VALUE);
 	REQUIRE(vtok.value.i() == 3);
-	FuncTok& ftok = (FuncTok&)*expr3[3];
+	Tok& ftok = expr3[3];
+	REQUIRE(ftok.form == Tok::FUNC);
 	REQUIRE(ftok.num_args == 3);
 	REQUIRE(ftok.num_unnamed_args == 2);
-	REQUIRE(ftok.named_args.size() == 1);
-	REQUIRE(ftok.named_args[0] == "c");
+	REQUIRE(ftok.call->named_args.size() == 1);
+	REQUIRE(ftok.call->named_args[0] == "c");
 }
 
 TEST_CASE("if", "[constructor]") {
@@ -132,11 +142,399 @@ TEST_CASE("if", "[constructor]") {
 
 	REQUIRE(block.size() == 1);
 	If& if_statement = dynamic_cast<If&>(*block[0]);
-	REQUIRE(if_statement.expr[2]->token->str() == "<");
+	REQUIRE(if_statement.expr[2].token->str() == "<");
 	If& elif_statement = dynamic_cast<If&>(*if_statement.else_block[0]);
-	REQUIRE(elif_statement.expr[2]->token->str() == ">");
+	REQUIRE(elif_statement.expr[2].token->str() == ">");
 
 	REQUIRE(  if_statement.true_block[0]->token.str() == "x");
 	REQUIRE(elif_statement.true_block[0]->token.str() == "y");
 	REQUIRE(elif_statement.else_block[0]->token.str() == "z");
 }
+
+TEST_CASE("submodule", "[constructor]") {
+	std::cout << "Construct submodule..." << std::endl;
+	Tokenizer tokenizer("module geo {\n\tfn area(): Int { 1 }\n}\nfn main(): I32 { 0 }");
+	Module mod;
+	mod.name.push_back("shapes");
+	Parser constructor;
+	constructor.construct(mod, tokenizer.get_tokens());
+
+	// the closing brace ends the submodule, main is back in the file's module
+	REQUIRE(mod.size() == 2);
+	REQUIRE(mod[0].form == Item::MODULE);
+	REQUIRE(mod[1].token.str() == "main");
+	Module& geo = ((SubModule&)mod[0]).module;
+	REQUIRE(geo.size() == 1);
+	REQUIRE(geo.name == std::vector<std::string>({"shapes", "geo"}));
+	REQUIRE(mod.search(std::vector<std::string>(1, "geo")) == &geo);
+}
+
+TEST_CASE("expression patching", "[constructor]") {
+	std::cout << "Patch expressions..." << std::endl;
+	Tokenizer tokenizer("a b c d");
+	auto& tokens = tokenizer.get_tokens();
+	Expr expr;
+	for (int i = 0; i < 4; i++) expr.push_back(Tok::make_var(tokens[i]));
+
+	// in any order, and several after the same node
+	std::vector<std::pair<size_t, Tok>> patches;
+	patches.emplace_back(3, Tok::make_func(tokens[1], 1));
+	patches.emplace_back(0, Tok::make_func(tokens[2], 1));
+	patches.emplace_back(0, Tok::make_func(tokens[3], 1));
+	expr.patch(patches);
+	REQUIRE(expr.size() == 7);
+	REQUIRE(expr[0].token->str() == "a");
+	REQUIRE(expr[1].token->str() == "c");
+	REQUIRE(expr[1].form == Tok::FUNC);
+	REQUIRE(expr[2].token->str() == "d");
+	REQUIRE(expr[3].token->str() == "b");
+	REQUIRE(expr[3].form == Tok::VAR);
+	REQUIRE(expr[6].token->str() == "b");
+	REQUIRE(expr[6].form == Tok::FUNC);
+
+	Tok tok = Tok::make_value(tokens[0], Value(true));
+	expr.splice(1, 3, &tok, 1);
+	REQUIRE(expr.size() == 5);
+	REQUIRE(expr[1].form == Tok::VALUE);
+	REQUIRE(expr[2].token->str() == "c");
+	expr.splice(5, 0, &tok, 1);
+	REQUIRE(expr.size() == 6);
+	REQUIRE(expr.back().form == Tok::VALUE);
+}
+
+TEST_CASE("builtin operators", "[constructor]") {
+	std::cout << "Look up builtin operators..." << std::endl;
+	Std std;
+	uint32_t plus = Interner::get().intern("+");
+	auto& binary = std.get_operators(2, plus);
+	REQUIRE(binary.size() > 10);
+	for (Function* func : binary) {
+		REQUIRE(func->form == Function::OP);
+		REQUIRE(func->param_types.size() == 2);
+		REQUIRE(func->param_types[0] == func->param_types[1]);
+	}
+	REQUIRE(std.get_operators(1, plus).empty());
+	REQUIRE(std.get_operators(1, Interner::get().intern("!")).size() == 1);
+
+	// modules never get their own copies
+	Module mod;
+	REQUIRE(mod.get_functions(2, plus).empty());
+
+	// every cast is made up front, so looking one up twice gives the same function
+	Function* cast = std.get_cast(Type::I32, Type::I64);
+	REQUIRE(cast != nullptr);
+	REQUIRE(cast->form == Function::CAST);
+	REQUIRE(cast->return_type == Type::I64);
+	REQUIRE(std.get_cast(Type::I32, Type::I64) == cast);
+	REQUIRE(std.get_cast(Type::IntLit, Type::F64) != nullptr);
+	REQUIRE(std.get_cast(Type::F64, Type::I32) == nullptr);
+	REQUIRE(std.get_cast(Type::I32, Type::IntLit) == nullptr);
+	REQUIRE(std.get_cast(Type::Bool, Type::I32) == nullptr);
+}
+
+// resolves the parameters & builtin operators used by the top level statements of a function,
+// the way the compiler would, for tests that only want to type check it
+void resolve_by_hand(Module& mod, Function& func, const Std& std, State& state) {
+	state.set_func(func);
+	state.descend();
+	for (size_t i = 0; i < func.param_names.size(); i++) {
+		state.declare(func.param_names[i]->symbol(), func.param_types[i]);
+	}
+	for (Statement* statement : func.block) {
+		for (Tok& tok : statement->expr) {
+			if (tok.form == Tok::VAR) {
+				tok.var = state.lookup(tok.token->symbol());
+			} else if (tok.form == Tok::FUNC) {
+				tok.call = mod.arena().make<Call>();
+				tok.call->possible_funcs = std.get_operators(tok.num_unnamed_args,
+				                                             tok.token->symbol());
+			}
+		}
+	}
+	state.ascend();
+}
+
+TEST_CASE("overload cache", "[constructor]") {
+	std::cout << "Cache overload resolution..." << std::endl;
+	Tokenizer tokenizer("fn f(a: I32, b: I64): I64 { return a * b + a * b }");
+	Module mod;
+	Parser constructor;
+	constructor.construct(mod, tokenizer.get_tokens());
+	Function& func = (Function&)mod[0];
+	Std std;
+	State state(mod);
+	resolve_by_hand(mod, func, std, state);
+	Expr& expr = func.block[0]->expr;
+
+	TypeChecker checker(std);
+	checker.check(mod, func, state);
+	// the second a * b is the same candidates & types as the first
+	REQUIRE(checker.overload_lookups() == 3);
+	REQUIRE(checker.overload_hits() == 1);
+	int casts = 0;
+	for (const Tok& tok : expr) {
+		if (tok.form != Tok::FUNC) continue;
+		REQUIRE(tok.call->func != nullptr);
+		if (tok.call->func->form == Function::CAST) {
+			casts++;
+		} else {
+			REQUIRE(tok.call->func->param_types[0] == Type::I64);
+		}
+	}
+	REQUIRE(casts == 2);
+}
+
+TEST_CASE("target int width", "[constructor]") {
+	std::cout << "Rank Int by the target's width..." << std::endl;
+	// the type of the + chosen for a: Int + b: other, with Int as wide as pointer_size
+	auto chosen = [](const std::string& other, int pointer_size) {
+		Tokenizer tokenizer("fn f(a: Int, b: " + other + ") { a + b }");
+		Module mod;
+		Parser constructor;
+		constructor.construct(mod, tokenizer.get_tokens());
+		Function& func = (Function&)mod[0];
+		Std std(pointer_size);
+		State state(mod);
+		resolve_by_hand(mod, func, std, state);
+		TypeChecker checker(std);
+		checker.check(mod, func, state);
+		return func.block[0]->expr.back().call->func->return_type;
+	};
+	REQUIRE(Std(4).size(Type::Int) == 4);
+	REQUIRE(Std(4).size(Type::UPtr) == 4);
+	REQUIRE(Std(8).size(Type::I64) == 8);
+	REQUIRE(Type(Type::Int).size() == 0);
+	REQUIRE(chosen("I32", 8) == Type::Int);
+	REQUIRE(chosen("I64", 4) == Type::I64);
+	REQUIRE(chosen("I16", 4) == Type::Int);
+}
+
+TEST_CASE("purity", "[constructor]") {
+	std::cout << "Check purity..." << std::endl;
+	Tokenizer tokenizer("global g: Int = 1\n"
+	                    "fn same(a: Int): Int { return a }\n"
+	                    "fn reads(): Int { return g }\n"
+	                    "fn writes() { g = 2 }\n"
+	                    "fn even(n: Int): Int { return odd(n) }\n"
+	                    "fn odd(n: Int): Int { return even(n) + reads() }\n"
+	                    "fn calls(): Int { writes()\n return same(1) }");
+	Module mod;
+	Parser constructor;
+	constructor.construct(mod, tokenizer.get_tokens());
+	Global& global = (Global&)mod[0];
+	std::unordered_map<std::string, Function*> funcs;
+	for (size_t i = 1; i < mod.size(); i++) {
+		funcs[mod[i].token.str()] = (Function*)&mod[i];
+	}
+
+	// only what the checker looks at is resolved, the globals & the functions called
+	for (auto& named : funcs) {
+		for (Statement* statement : named.second->block) {
+			if (statement->form == Statement::ASSIGNMENT) {
+				((Assignment*)statement)->var.global = &global.var;
+			}
+			for (Tok& tok : statement->expr) {
+				if (tok.form == Tok::VAR && tok.token->str() == "g") {
+					tok.var.global = &global.var;
+				} else if (tok.form == Tok::FUNC && funcs.count(tok.token->str())) {
+					tok.call = mod.arena().make<Call>();
+					tok.call->func = funcs[tok.token->str()];
+				}
+			}
+		}
+	}
+
+	PurityChecker checker;
+	checker.check(mod);
+	REQUIRE(funcs["same"]->purity == Function::READ_NONE);
+	REQUIRE(funcs["reads"]->purity == Function::READ_ONLY);
+	REQUIRE(funcs["writes"]->purity == Function::WRITES);
+	// each only as pure as the other, and what it calls
+	REQUIRE(funcs["even"]->purity == Function::READ_ONLY);
+	REQUIRE(funcs["odd"]->purity == Function::READ_ONLY);
+	REQUIRE(funcs["calls"]->purity == Function::WRITES);
+	REQUIRE(checker.pure_functions() == 4);
+}
+
+TEST_CASE("module paths", "[constructor]") {
+	std::cout << "Search module paths..." << std::endl;
+	Module mod;
+	Module* a = mod.create_submodule("a");
+	Module* b = a->create_submodule("b");
+	REQUIRE(mod.create_submodule("a") == nullptr);
+
+	Tokenizer tokenizer("a.b.f a.b.f a.c");
+	auto& tokens = tokenizer.get_tokens();
+	Ident ident = tokens[0].ident();
+	REQUIRE(ident.path(2) == tokens[1].ident().path(2));
+	REQUIRE(ident.path(2) != tokens[2].ident().path(2));
+	REQUIRE(ident.path(1) == tokens[2].ident().path(1));
+
+	REQUIRE(mod.search(ident, 1) == a);
+	REQUIRE(mod.search(tokens[1].ident(), 1) == a);
+	REQUIRE(mod.search(ident, 2) == nullptr);
+	REQUIRE(a->search(ident.begin() + 1, ident.begin() + 2) == b);
+	REQUIRE(mod.search(std::vector<std::string>{"a"}) == a);
+	REQUIRE(a->search(std::vector<std::string>{"c"}) == nullptr);
+}
+
+TEST_CASE("variable slots", "[constructor]") {
+	std::cout << "Resolve variables to slots..." << std::endl;
+	Tokenizer tokenizer("global x: Int = 1\nfn f(a: Int, b: Int) { }");
+	Module mod;
+	Parser constructor;
+	constructor.construct(mod, tokenizer.get_tokens());
+	REQUIRE(mod.size() == 2);
+	REQUIRE(mod[0].form == Item::GLOBAL);
+	mod.declare((Global&)mod[0]);
+	Function& func = (Function&)mod[1];
+	auto& interner = Interner::get();
+	uint32_t a = interner.intern("a"), b = interner.intern("b"), x = interner.intern("x");
+
+	State state(mod);
+	state.set_func(func);
+	state.descend();
+	REQUIRE(state.declare(a, Type::Int) == 0);
+	REQUIRE(state.declare(b, Type::Int) == 1);
+	REQUIRE(state.declare(a, Type::Int) == -1);
+	REQUIRE(state.lookup(x).global == &((Global&)mod[0]).var);
+	state.descend();
+	REQUIRE(state.declare(x, Type::Float) == 2);
+	REQUIRE(state.declare(a, Type::Bool) == 3);
+	REQUIRE(state.lookup(a).slot == 3);
+	REQUIRE(state.lookup(x).slot == 2);
+	REQUIRE(state.get_var(state.lookup(x)).type == Type::Float);
+	state.ascend();
+	REQUIRE(state.lookup(a).slot == 0);
+	REQUIRE(state.lookup(x).slot == -1);
+	REQUIRE(state.lookup(x).global != nullptr);
+	REQUIRE(!state.lookup(interner.intern("c")).resolved());
+	state.ascend();
+	REQUIRE(func.locals.size() == 4);
+
+	REQUIRE(state.get_loop(1) == nullptr);
+	state.push_loop();
+	state.push_loop();
+	REQUIRE(state.get_loop(2) != nullptr);
+	REQUIRE(state.get_loop(2) != state.get_loop(1));
+	REQUIRE(state.get_loop(3) == nullptr);
+	state.pop_loop();
+	state.pop_loop();
+	REQUIRE(state.get_loop(1) == nullptr);
+}
+
+TEST_CASE("pass manager", "[constructor]") {
+	std::cout << "Fuse function passes..." << std::endl;
+	Tokenizer tokenizer("fn f() { }\nfn g() { }");
+	Module mod;
+	Parser constructor;
+	constructor.construct(mod, tokenizer.get_tokens());
+
+	for (bool fused : { true, false }) {
+		Stats stats;
+		std::string order;
+		PassManager passes(stats, fused);
+		passes.add_module_pass("m", [&](Module&) { order += "m "; });
+		passes.add_function_pass("a", [&](Module&, Function& func) {
+			order += "a" + func.token.str() + " ";
+		});
+		passes.add_function_pass("b", [&](Module&, Function& func) {
+			order += "b" + func.token.str() + " ";
+		});
+		passes.run(mod);
+		REQUIRE(order == (fused ? "m af bf ag bg " : "m af ag bf bg "));
+
+		std::stringstream ss;
+		stats.print(ss);
+		REQUIRE(ss.str().find("pass: a") != std::string::npos);
+		REQUIRE(ss.str().find("pass: b") != std::string::npos);
+		REQUIRE(ss.str().find("semantic passes") != std::string::npos);
+	}
+
+	// every function goes through each parallel pass once, on one of the threads
+	Stats stats;
+	PassManager passes(stats, true, 4);
+	std::atomic<int> visits[2][2];
+	std::atomic<int> bad_threads(0);
+	for (auto& pass : visits) for (auto& visit : pass) visit = 0;
+	for (int j = 0; j < 2; j++) {
+		passes.add_parallel_pass("p", [&, j](Module&, Function& func, unsigned thread) {
+			// catch's assertions can't be used off the main thread
+			if (thread >= 4) bad_threads++;
+			visits[j][func.token.str() == "f" ? 0 : 1]++;
+		});
+	}
+	passes.run(mod);
+	REQUIRE(bad_threads == 0);
+	for (auto& pass : visits) {
+		REQUIRE(pass[0] == 1);
+		REQUIRE(pass[1] == 1);
+	}
+}
+
+TEST_CASE("construct benchmark", "[.benchmark]") {
+	std::string source;
+	for (int i = 0; source.size() < (4 << 20); i++) {
+		source += "fn f" + std::to_string(i) + "(a: Int, b: Int): Int {\n"
+		          "\tx := a * 2 + b\n\twhile x > 0 { x -= if a > b { 1 } else { 2 } }\n"
+		          "\treturn x + a / (b + 1)\n}\n";
+	}
+	Tokenizer tokenizer(source);
+	auto start = std::chrono::steady_clock::now();
+	{
+		Module mod;
+		Parser constructor;
+		constructor.construct(mod, tokenizer.get_tokens());
+		std::cout << mod.size() << " items, " << mod.arena().objects() << " nodes, "
+		          << mod.arena().bytes_used() << " bytes" << std::endl;
+	}
+	auto time = std::chrono::steady_clock::now() - start;
+	std::cout << "parsed and freed in " << std::chrono::duration<double, std::milli>(time).count()
+	          << " ms" << std::endl;
+}
+
+TEST_CASE("resolve benchmark", "[.benchmark]") {
+	std::string source;
+	for (int i = 0; i < 50000; i++) {
+		std::string callee = "f" + std::to_string(i == 0 ? 0 : i - 1);
+		source += "fn f" + std::to_string(i) + "(a: Int, b: Int): Int {\n"
+		          "\tx := " + callee + "(a, b) + a\n\treturn " + callee + "(x, b) * b\n}\n";
+	}
+	Tokenizer tokenizer(source);
+	Module mod;
+	Parser constructor;
+	constructor.construct(mod, tokenizer.get_tokens());
+	State state(mod);
+
+	// the declarations and lookups the resolver does for every item and identifier
+	auto start = std::chrono::steady_clock::now();
+	size_t found = 0;
+	for (size_t i = 0; i < mod.size(); i++) {
+		mod.declare((Function&)mod[i]);
+	}
+	for (size_t i = 0; i < mod.size(); i++) {
+		Function& func = (Function&)mod[i];
+		state.set_func(func);
+		state.descend();
+		for (size_t j = 0; j < func.param_names.size(); j++) {
+			state.declare(func.param_names[j]->symbol(), func.param_types[j]);
+		}
+		for (Statement* statement : func.block) {
+			if (statement->form == Statement::DECLARATION) {
+				state.declare(statement->token.symbol(), Type::Int);
+			}
+			for (const Tok& tok : statement->expr) {
+				if (tok.form == Tok::VAR) {
+					found += state.lookup(tok.token->symbol()).resolved();
+				} else if (tok.form == Tok::FUNC && tok.token->form == Token::IDENT) {
+					found += !mod.get_functions(tok.num_unnamed_args, tok.token->symbol()).empty();
+				}
+			}
+		}
+		state.ascend();
+	}
+	auto time = std::chrono::steady_clock::now() - start;
+	REQUIRE(found == 50000 * 8);
+	std::cout << "resolved " << found << " identifiers in "
+	          << std::chrono::duration<double, std::milli>(time).count() << " ms" << std::endl;
+}
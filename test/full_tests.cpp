@@ -2,17 +2,24 @@
 #include "Compiler.h"
 #include "util/Filesystem.h"
 
-void test(const std::string& filename, int expected_result) {
+void test(const std::string& filename, int expected_result, Options options = Options()) {
 	std::cout << "Testing " << filename << std::endl;
 	std::ifstream file(filename);
 	std::stringstream buffer;
 	buffer << file.rdbuf();
 
-	Compiler compiler(filename, "../out", "../../out");
+	Compiler compiler(filename, "../out", "../../out", options);
 
 	REQUIRE(exec("../../out") == expected_result);
 }
 
+int run(const std::string& filename, Options options = Options()) {
+	std::cout << "Running " << filename << std::endl;
+	options.emit = Options::RUN;
+	Compiler compiler(filename, "../out", "", options);
+	return compiler.run();
+}
+
 TEST_CASE("full tests", "[full]") {
 	bool success = change_directory("test/test_code");
 	REQUIRE(success);
@@ -30,4 +37,173 @@ TEST_CASE("full tests", "[full]") {
 	test("import.eb", 8);
 	test("struct.eb", 0);
 	test("readme.eb", 0);
+
+	// spooks is inlined into main across the files
+	Options lto;
+	lto.lto = true;
+	lto.opt_level = 2;
+	test("import.eb", 8, lto);
+	test("struct.eb", 0, lto);
+
+	// the same, but only by copying spooks into import's module
+	Options thin;
+	thin.thin_lto = true;
+	test("import.eb", 8, thin);
+	test("readme.eb", 0, thin);
+
+	// functions split into shards built on their own threads and linked back together,
+	// recompiled since the obj files from before would otherwise be reused
+	Options shards;
+	shards.function_jobs = 4;
+	shards.force_recompile = true;
+	test("struct.eb", 0, shards);
+	test("import.eb", 8, shards);
+	test("readme.eb", 0, shards);
+
+	Options wrap;
+	wrap.overflow = Options::WRAP;
+	test("overflow.eb", 0, wrap);
+	// nothing in these overflows, so checking changes nothing
+	Options trap;
+	trap.overflow = Options::TRAP;
+	test("fib.eb", 0, trap);
+	test("loops.eb", 0, trap);
+	test("readme.eb", 0, trap);
+	// while overflow.eb stops at its first addition. the shell is kept from exec'ing the program,
+	// so being killed by a signal shows up as 128 + the signal instead of a plain 0
+	Compiler trapped("overflow.eb", "../out", "../../out", trap);
+	REQUIRE(exec("../../out; exit $?") > 128);
+}
+
+TEST_CASE("obj cache", "[full]") {
+	if (!file_exists("simple.eb")) {
+		bool success = change_directory("test/test_code");
+		REQUIRE(success);
+	}
+	// the second build loads dep from its obj file
+	test("import.eb", 8);
+	test("import.eb", 8);
+
+	std::ifstream in("../out/dep-.ll.o", std::ifstream::binary);
+	std::stringstream buffer;
+	buffer << in.rdbuf();
+	in.close();
+	std::string obj = buffer.str();
+	REQUIRE(obj.size() > 16);
+
+	// cut short, it is rebuilt
+	std::ofstream("../out/dep-.ll.o", std::ofstream::binary) << obj.substr(0, obj.size() / 2);
+	test("import.eb", 8);
+	// a valid header followed by lengths far past the end
+	std::ofstream("../out/dep-.ll.o", std::ofstream::binary)
+			<< obj.substr(0, 12) << std::string(obj.size() - 12, '\xff');
+	test("import.eb", 8);
+
+	// a file's submodules are part of its interface, and come back when it is reused
+	auto write_shapes = [](const std::string& corners_param) {
+		std::ofstream("shapes.eb") <<
+				"pub module polygon {\n"
+				"\tpub struct Square { side: Int }\n"
+				"\tpub fn corners(square: " << corners_param << "): I32 {\n\t\treturn 4\n\t}\n"
+				"}\n\n"
+				"pub fn sides(): I32 {\n\treturn 4\n}\n";
+	};
+	write_shapes("Square");
+	std::ofstream("uses_shapes.eb") << "#include shapes.eb\n\nfn main(): I32 {\n"
+	                               "\treturn shapes.sides()\n}\n";
+	test("uses_shapes.eb", 4);
+	test("uses_shapes.eb", 4);
+	// only the submodule changes, uses_shapes.eb is rebuilt against it
+	write_shapes("I64");
+	test("uses_shapes.eb", 4);
+	test("uses_shapes.eb", 4);
+	std::remove("shapes.eb");
+	std::remove("uses_shapes.eb");
+}
+
+TEST_CASE("jit tests", "[jit]") {
+	// the full tests may have already moved there
+	if (!file_exists("simple.eb")) {
+		bool success = change_directory("test/test_code");
+		REQUIRE(success);
+	}
+	REQUIRE(run("simple.eb") == 0);
+	REQUIRE(run("loops.eb") == 0);
+	REQUIRE(run("functional.eb") == 0);
+	REQUIRE(run("overloading.eb") == 0);
+	REQUIRE(run("fib.eb") == 0);
+	REQUIRE(run("short.eb") == 0);
+	REQUIRE(run("import.eb") == 8);
+	REQUIRE(run("struct.eb") == 0);
+	REQUIRE(run("readme.eb") == 0);
+
+	Options lto;
+	lto.lto = true;
+	REQUIRE(run("import.eb", lto) == 8);
+}
+
+TEST_CASE("native cpu", "[jit]") {
+	if (!file_exists("simple.eb")) {
+		bool success = change_directory("test/test_code");
+		REQUIRE(success);
+	}
+	// vectorized for whatever this machine has
+	Options options;
+	options.emit = Options::RUN;
+	options.opt_level = 3;
+	options.cpu = "native";
+	Compiler compiler("loops.eb", "../out", "", options);
+	REQUIRE(compiler.run() == 0);
+}
+
+TEST_CASE("wide struct benchmark", "[.benchmark]") {
+	// every member written is one store, however many members the struct has
+	const int num_members = 64;
+	std::string source = "struct Wide {";
+	for (int i = 0; i < num_members; i++) {
+		source += (i ? ", m" : " m") + std::to_string(i) + ": Int";
+	}
+	source += " }\n\nfn main(): I32 {\n\twide := Wide(";
+	for (int i = 0; i < num_members; i++) {
+		source += (i ? ", m" : "m") + std::to_string(i) + " = " + std::to_string(i);
+	}
+	source += ")\n\ti := 0\n\twhile i < 10000000 {\n";
+	for (int i = 0; i < num_members; i += 8) {
+		source += "\t\twide.m" + std::to_string(i) + " += i\n";
+	}
+	source += "\t\ti += 1\n\t}\n\tif wide.m8 - wide.m0 != 8 { return 1 }\n\treturn 0\n}\n";
+	std::ofstream("wide_struct.eb") << source;
+
+	auto start = std::chrono::steady_clock::now();
+	REQUIRE(run("wide_struct.eb") == 0);
+	auto time = std::chrono::steady_clock::now() - start;
+	std::cout << "compiled and ran in " << std::chrono::duration<double, std::milli>(time).count()
+	          << " ms" << std::endl;
+	std::remove("wide_struct.eb");
+}
+
+TEST_CASE("overflow benchmark", "[.benchmark]") {
+	// a hot loop of nothing but integer arithmetic, where the checks cost the most
+	std::ofstream("overflow_loop.eb") <<
+			"fn main(): I32 {\n"
+			"\ti: U32 = 0\n\tsum: U32 = 0\n"
+			"\twhile i < 100000000 {\n"
+			"\t\tsum += i % 7 * 3 + 1\n"
+			"\t\ti += 1\n"
+			"\t}\n"
+			"\tif sum == 0 { return 1 }\n"
+			"\treturn 0\n"
+			"}\n";
+	const char* names[] = { "undefined", "wrap", "trap" };
+	for (auto overflow : { Options::UNDEFINED, Options::WRAP, Options::TRAP }) {
+		Options options;
+		options.opt_level = 2;
+		options.overflow = overflow;
+		auto start = std::chrono::steady_clock::now();
+		REQUIRE(run("overflow_loop.eb", options) == 0);
+		auto time = std::chrono::steady_clock::now() - start;
+		std::cout << "--overflow " << names[overflow] << ": "
+		          << std::chrono::duration<double, std::milli>(time).count() << " ms" << std::endl;
+	}
+	std::remove("overflow_loop.eb");
 }
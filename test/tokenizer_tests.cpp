@@ -1,5 +1,8 @@
 #include <Tokenizer.h>
 #include "catch.hpp"
+#include <chrono>
+#include <fstream>
+#include <iostream>
 
 TEST_CASE("Tokenize simple", "[tokenizer]") {
 	Tokenizer tokenizer("Hello world!");
@@ -52,3 +55,65 @@ TEST_CASE("Tokenize numbers", "[tokenizer]") {
 	REQUIRE(tokens[8].i() == 3);
 	REQUIRE(tokens[9].i() == 17);
 }
+
+TEST_CASE("Tokenize long input", "[tokenizer]") {
+	// used to recurse once per token
+	std::string source;
+	for (int i = 0; i < 200000; i++) {
+		source += "x.y = 1 + 2; // comment\n";
+	}
+	Tokenizer tokenizer(source);
+	auto& tokens = tokenizer.get_tokens();
+	REQUIRE(tokens.size() == 200000 * 7);
+	REQUIRE(tokens.back().form == Token::Form::END);
+	REQUIRE(tokens.back().line == 200000);
+}
+
+TEST_CASE("Tokenize benchmark", "[.benchmark]") {
+	std::ifstream file("test/test_code/readme.eb");
+	REQUIRE(file.is_open());
+	std::stringstream buffer;
+	buffer << file.rdbuf();
+	std::string source;
+	while (source.size() < (8 << 20)) {
+		source += buffer.str() + "\n";
+	}
+	auto start = std::chrono::steady_clock::now();
+	Tokenizer tokenizer(source);
+	auto time = std::chrono::steady_clock::now() - start;
+	std::cout << source.size() << " bytes, " << tokenizer.get_tokens().size() << " tokens in "
+	          << std::chrono::duration<double, std::milli>(time).count() << " ms" << std::endl;
+}
+
+TEST_CASE("Tokenize mapped file", "[tokenizer]") {
+	std::string source = "#include a.eb\nfn main(): I32 {\n\treturn x.y + 0x10\n}";
+	{
+		std::ofstream file("tokenizer_mapped.eb", std::ofstream::binary);
+		file << source;
+	}
+	MappedFile file("tokenizer_mapped.eb");
+	REQUIRE(file.is_open());
+	REQUIRE(file.size() == source.size());
+	Tokenizer mapped(file);
+	Tokenizer copied(source);
+	std::remove("tokenizer_mapped.eb");
+	REQUIRE(mapped.get_tokens() == copied.get_tokens());
+	REQUIRE(mapped.get_traits() == copied.get_traits());
+	REQUIRE(mapped.get_tokens().back().str() == "}");
+
+	MappedFile missing("tokenizer_missing.eb");
+	REQUIRE(!missing.is_open());
+}
+
+TEST_CASE("Tokenize interned", "[tokenizer]") {
+	Tokenizer tokenizer("abc + abc.de.abc\n+");
+	auto& tokens = tokenizer.get_tokens();
+	REQUIRE(tokens.size() == 5);
+	REQUIRE(tokens[0].symbol() == tokens[2].symbol());
+	REQUIRE(tokens[1].symbol() == tokens[4].symbol());
+	REQUIRE(tokens[2].ident().size() == 3);
+	REQUIRE(tokens[2].ident().id(2) == tokens[0].symbol());
+	REQUIRE(tokens[2].ident().strs() == std::vector<std::string>({"abc", "de", "abc"}));
+	REQUIRE(Interner::get().str(tokens[1].symbol()) == "+");
+	REQUIRE(sizeof(Token) <= 24);
+}